@@ -67,6 +67,51 @@ int main()
 		});
 	}
 	
+	{
+		using arch::with;
+		benchmark.run("archecs bulk", [&]
+		{
+			arch::world my_world{};
+			my_world.create_entities(iterations, t1{1, 1, 1}, t2{1, 1, 1});
+			for (std::size_t i = 0; i < foreach_calls; ++i)
+			{
+				my_world.for_all(with<t1 &> and with<t2 &>, [](arch::entity, t1 &first, t2 &second)
+				{
+					first.x = 1;
+					first.y = 1;
+					first.z = 1;
+					second.x = 1;
+					second.y = 1;
+					second.z = 1;
+				});
+			}
+		});
+	}
+	
+	{
+		using arch::with;
+		benchmark.run("archecs chunks", [&]
+		{
+			arch::world my_world{};
+			my_world.create_entities(iterations, t1{1, 1, 1}, t2{1, 1, 1});
+			for (std::size_t i = 0; i < foreach_calls; ++i)
+			{
+				my_world.for_each_chunk(with<t1> and with<t2>, [](std::span<const arch::entity> entities, std::span<t1> first, std::span<t2> second)
+				{
+					for (std::size_t j = 0; j < entities.size(); ++j)
+					{
+						first[j].x = 1;
+						first[j].y = 1;
+						first[j].z = 1;
+						second[j].x = 1;
+						second[j].y = 1;
+						second[j].z = 1;
+					}
+				});
+			}
+		});
+	}
+	
 	//{
 	//	using arch::with;
 	//	benchmark.run("archecs buffered", [&]
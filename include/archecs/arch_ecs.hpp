@@ -1,9 +1,13 @@
 #pragma once
 
 #include "queries.hpp"
+#include "query_cache.hpp"
 #include "archetype.hpp"
 #include "world.hpp"
+#include "thread_pool.hpp"
 #include "command_buffer.hpp"
+#include "snapshot.hpp"
+#include "memory.hpp"
 #include "system.hpp"
 #include "update_group.hpp"
 
@@ -3,6 +3,11 @@
 #include <array>
 #include <span>
 #include <vector>
+#include <unordered_map>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
 #include <memory_resource>
 
 #if _MSC_VER && !__INTEL_COMPILER // msvc getting a special treatment... (https://en.cppreference.com/w/cpp/language/operator_alternative)
@@ -11,7 +16,8 @@
 
 #include "internal/helper_macros.hpp"
 #include "internal/constructor_vtable.hpp"
-#include "internal/rtt_vector.hpp"
+#include "internal/chunk.hpp"
+#include "internal/component_mask.hpp"
 #include "type_id.hpp"
 #include "entity.hpp"
 
@@ -19,94 +25,367 @@ namespace arch
 {
 	namespace det
 	{
+		/// a memcpy of a single component from a row of one archetype to a row of another archetype
+		struct column_move
+		{
+			std::size_t source_offset;
+			std::size_t target_offset;
+			std::size_t element_size;
+		};
+		
+		/// rows that are next to each other and inside a single chunk in both the source and the target archetype of a move
+		struct row_run
+		{
+			std::byte *own_chunk;
+			std::size_t own_in_chunk_index;
+			std::byte *other_chunk;
+			std::size_t other_in_chunk_index;
+			std::size_t n_rows;
+		};
+		
+		/// precomputed mapping of the columns of one archetype onto the columns of another
+		struct archetype_transition
+		{
+			std::size_t target_archetype_index;
+			/// components both archetypes contain
+			std::pmr::vector<column_move> moved_columns;
+			/// components only the source archetype contains
+			std::pmr::vector<chunk_column> destroyed_columns;
+		};
+		
 		class archetype_internal
 		{
 		public:
-			[[nodiscard]]
-			std::uint32_t get_combined_types_hash() const
+			archetype_internal() = default;
+			
+			archetype_internal(archetype_internal &&other) noexcept
+					: _type_data(std::move(other._type_data)),
+					  _component_mask(other._component_mask),
+					  _columns(std::move(other._columns)),
+					  _chunks(std::move(other._chunks)),
+					  _add_edges(std::move(other._add_edges)),
+					  _remove_edges(std::move(other._remove_edges)),
+					  _transitions(std::move(other._transitions)),
+					  _resource(other._resource),
+					  _chunk_resource(other._chunk_resource),
+					  _size(other._size),
+					  _chunk_capacity(other._chunk_capacity),
+					  _chunk_bytes(other._chunk_bytes),
+					  _chunk_alignment(other._chunk_alignment),
+					  _change_ticks_offset(other._change_ticks_offset),
+					  _change_tick_source(other._change_tick_source)
 			{
-				std::uint32_t result = 0;
-				for (type_id info: _type_data)
+				other._chunks.clear();
+				other._size = 0;
+			}
+			
+			archetype_internal(const archetype_internal &) = delete;
+			
+			archetype_internal &operator=(archetype_internal &&other) noexcept
+			{
+				if (this != &other)
 				{
-					result = det::hashing::combine_hashes(result, info.value);
+					std::destroy_at(this);
+					std::construct_at(this, std::move(other));
 				}
-				return result;
+				return *this;
 			}
 			
-			/// adds a given entity to the archetype
+			archetype_internal &operator=(const archetype_internal &) = delete;
+			
+			~archetype_internal()
+			{
+				for (chunk &current_chunk: _chunks)
+				{
+					release_chunk(current_chunk);
+				}
+			}
+		
+		public:
+			/// adds a given entity to the archetype. its components are left uninitialized
 			/// \return the index inside the archetype
 			std::size_t add_entity(entity to_add)
 			{
-				std::size_t entity_index = _entities.size();
+				if (_chunks.empty() || _chunks.back().size == _chunk_capacity)
+				{
+					_chunks.push_back(allocate_chunk());
+				}
+				
+				chunk &last_chunk = _chunks.back();
+				make_chunk_writable(last_chunk);
+				reinterpret_cast<entity *>(last_chunk.data)[last_chunk.size] = to_add;
+				++last_chunk.size;
+				mark_chunk_changed(last_chunk);
+				
+				return _size++;
+			}
+			
+			/// adds the given entities to the archetype, filling up the last chunk before allocating new ones. their components are left uninitialized
+			/// \return the index of the first added entity inside the archetype. the other entities follow in order
+			std::size_t add_entities(std::span<const entity> to_add)
+			{
+				const std::size_t first_index = _size;
+				_chunks.reserve((_size + to_add.size() + _chunk_capacity - 1) / _chunk_capacity);
 				
-				_entities.push_back(to_add);
-				for (auto &component_vector: _component_data)
+				std::size_t n_added = 0;
+				while (n_added < to_add.size())
 				{
-					component_vector.push_back();
+					if (_chunks.empty() || _chunks.back().size == _chunk_capacity)
+					{
+						_chunks.push_back(allocate_chunk());
+					}
+					
+					chunk &last_chunk = _chunks.back();
+					make_chunk_writable(last_chunk);
+					const std::size_t n_copied = std::min(_chunk_capacity - last_chunk.size, to_add.size() - n_added);
+					std::memcpy(reinterpret_cast<entity *>(last_chunk.data) + last_chunk.size, to_add.data() + n_added, n_copied * sizeof(entity));
+					last_chunk.size += n_copied;
+					n_added += n_copied;
+					mark_chunk_changed(last_chunk);
 				}
 				
-				return entity_index;
+				_size += to_add.size();
+				return first_index;
+			}
+			
+			/// calls function(chunk_index, first_in_chunk_index, n_entities) for every part of the entities [first_index, first_index + count)
+			/// that lies inside a single chunk
+			template<typename t_function>
+			void for_each_chunk_range(std::size_t first_index, std::size_t count, t_function &&function) const
+			{
+				arch_assert_external(first_index + count <= _size);
+				
+				auto [chunk_index, in_chunk_index] = locate(first_index);
+				while (count != 0)
+				{
+					const std::size_t n_in_chunk = std::min(_chunk_capacity - in_chunk_index, count);
+					function(chunk_index, in_chunk_index, n_in_chunk);
+					
+					count -= n_in_chunk;
+					++chunk_index;
+					in_chunk_index = 0;
+				}
 			}
 			
-			/// Removes entity by moving the last entity to its place
+			/// \return if the components of all columns can be copied, see is_copyable_component
+			[[nodiscard]]
+			bool is_copyable() const
+			{
+				return std::all_of(_columns.begin(), _columns.end(), [](const chunk_column &column)
+				{
+					return column.destructor.copy != nullptr;
+				});
+			}
+			
+			/// copy constructs every component of the entity at source_index into the uninitialized entities [first_index, first_index + count)
+			void fill_with_copies_of(std::size_t source_index, std::size_t first_index, std::size_t count)
+			{
+				arch_assert_external(source_index < first_index || source_index >= first_index + count);
+				
+				auto [source_chunk_index, source_in_chunk_index] = locate(source_index);
+				const std::byte *source_chunk = _chunks[source_chunk_index].data;
+				for_each_chunk_range(first_index, count, [&](std::size_t chunk_index, std::size_t first_in_chunk_index, std::size_t n_entities)
+				{
+					std::byte *target_chunk = _chunks[chunk_index].data;
+					for (const chunk_column &column: _columns)
+					{
+						arch_assert_internal(column.destructor.copy_fill != nullptr);
+						column.destructor.copy_fill(target_chunk + column.offset + first_in_chunk_index * column.element_size,
+						                            source_chunk + column.offset + source_in_chunk_index * column.element_size, n_entities);
+					}
+				});
+			}
+			
+			/// Removes entity by destroying its components and moving the last entity to its place
 			/// \param index of the entity to be destroyed
 			/// \return the swapped (non destroyed) entity
 			[[nodiscard]]
 			entity remove_entity(std::size_t index)
 			{
-				entity swapped_entity = _entities.back();
-				_entities[index] = swapped_entity;
-				_entities.pop_back();
-				
-				for (auto &component_vector: _component_data)
+				auto [chunk_index, in_chunk_index] = locate(index);
+				make_chunk_writable(_chunks[chunk_index]);
+				std::byte *chunk_data = _chunks[chunk_index].data;
+				for (const chunk_column &column: _columns)
 				{
-					component_vector.swap_back_remove(index);
+					column.destructor.value(chunk_data + column.offset + in_chunk_index * column.element_size, 1);
 				}
 				
-				return swapped_entity;
+				return fill_gap(index);
 			}
 			
-			std::pair<std::size_t, entity> move_entity_over_from(entity to_copy, archetype_internal &from_archetype, std::size_t in_archetype_index)
+			/// Moves an entity from from_archetype into this archetype. Components both archetypes have are moved over, components only
+			/// from_archetype has get destroyed and components only this archetype has are left uninitialized
+			/// \param transition from from_archetype to this archetype, as created by from_archetype.create_transition_to(*this)
+			/// \return the index inside this archetype and the entity that got swapped into the previous place inside from_archetype
+			std::pair<std::size_t, entity> move_entity_over_from(entity to_copy, archetype_internal &from_archetype, std::size_t in_archetype_index,
+			                                                     const archetype_transition &transition)
 			{
 				std::size_t own_archetype_index = add_entity(to_copy);
 				
+				auto [own_chunk_index, own_in_chunk_index] = locate(own_archetype_index);
+				auto [other_chunk_index, other_in_chunk_index] = from_archetype.locate(in_archetype_index);
+				from_archetype.make_chunk_writable(from_archetype._chunks[other_chunk_index]);
+				std::byte *own_chunk = _chunks[own_chunk_index].data;
+				std::byte *other_chunk = from_archetype._chunks[other_chunk_index].data;
+				
+				for (const column_move &moved: transition.moved_columns)
+				{
+					std::memcpy(own_chunk + moved.target_offset + own_in_chunk_index * moved.element_size,
+					            other_chunk + moved.source_offset + other_in_chunk_index * moved.element_size,
+					            moved.element_size);
+				}
+				
+				for (const chunk_column &destroyed: transition.destroyed_columns)
+				{
+					destroyed.destructor.value(other_chunk + destroyed.offset + other_in_chunk_index * destroyed.element_size, 1);
+				}
+				
+				entity swapped_entity = from_archetype.fill_gap(in_archetype_index);
+				return {own_archetype_index, swapped_entity};
+			}
+			
+			/// Moves many entities from from_archetype into this archetype like move_entity_over_from, but processes one column at a time and
+			/// copies rows that are next to each other in both archetypes with a single memcpy
+			/// \param to_copy the entities to move, to_copy[i] needs to be stored at in_archetype_indices[i] inside from_archetype
+			/// \param in_archetype_indices sorted ascending, without duplicates
+			/// \param on_swapped called with (entity, new index) for every entity of from_archetype that got moved into a freed place
+			/// \return the index of to_copy[0] inside this archetype, the other entities follow in order
+			template<typename t_on_swapped>
+			std::size_t move_entities_over_from(std::span<const entity> to_copy, archetype_internal &from_archetype,
+			                                    std::span<const std::size_t> in_archetype_indices, const archetype_transition &transition,
+			                                    t_on_swapped &&on_swapped)
+			{
+				arch_assert_internal(to_copy.size() == in_archetype_indices.size());
+				arch_assert_internal(&from_archetype != this);
+				
+				const std::size_t first_own_index = add_entities(to_copy);
+				
+				// split the rows into runs that are contiguous and inside a single chunk in both archetypes
+				std::vector<row_run> row_runs{};
+				for (std::size_t i = 0; i < in_archetype_indices.size();)
+				{
+					auto [own_chunk_index, own_in_chunk_index] = locate(first_own_index + i);
+					auto [other_chunk_index, other_in_chunk_index] = from_archetype.locate(in_archetype_indices[i]);
+					from_archetype.make_chunk_writable(from_archetype._chunks[other_chunk_index]);
+					
+					std::size_t n_rows = 1;
+					while (i + n_rows < in_archetype_indices.size()
+					       && in_archetype_indices[i + n_rows] == in_archetype_indices[i] + n_rows
+					       && own_in_chunk_index + n_rows < _chunk_capacity
+					       && other_in_chunk_index + n_rows < from_archetype._chunk_capacity)
+					{
+						++n_rows;
+					}
+					
+					row_runs.push_back({_chunks[own_chunk_index].data, own_in_chunk_index, from_archetype._chunks[other_chunk_index].data,
+					                     other_in_chunk_index, n_rows});
+					i += n_rows;
+				}
+				
+				for (const column_move &moved: transition.moved_columns)
+				{
+					for (const row_run &run: row_runs)
+					{
+						std::memcpy(run.own_chunk + moved.target_offset + run.own_in_chunk_index * moved.element_size,
+						            run.other_chunk + moved.source_offset + run.other_in_chunk_index * moved.element_size,
+						            run.n_rows * moved.element_size);
+					}
+				}
+				
+				for (const chunk_column &destroyed: transition.destroyed_columns)
+				{
+					for (const row_run &run: row_runs)
+					{
+						destroyed.destructor.value(run.other_chunk + destroyed.offset + run.other_in_chunk_index * destroyed.element_size, run.n_rows);
+					}
+				}
+				
+				// back to front, so that the last entity, which fills the gap, is never one that still needs to be removed
+				for (std::size_t i = in_archetype_indices.size(); i-- > 0;)
+				{
+					entity swapped_entity = from_archetype.fill_gap(in_archetype_indices[i]);
+					if (in_archetype_indices[i] < from_archetype._size)
+					{
+						on_swapped(swapped_entity, in_archetype_indices[i]);
+					}
+				}
+				
+				return first_own_index;
+			}
+			
+			/// calculates which columns need to be moved and which destroyed when moving an entity from this archetype into target
+			[[nodiscard]]
+			archetype_transition create_transition_to(const archetype_internal &target, std::size_t target_archetype_index) const
+			{
+				archetype_transition transition{target_archetype_index,
+				                                std::pmr::vector<column_move>(_columns.get_allocator()),
+				                                std::pmr::vector<chunk_column>(_columns.get_allocator())};
+				
 				std::size_t own_component_index = 0;
-				std::size_t other_component_index = 0;
-				while (other_component_index < from_archetype._type_data.size() && own_component_index < _type_data.size())
+				std::size_t target_component_index = 0;
+				while (own_component_index < _type_data.size())
 				{
-					auto own_current_type = _type_data[own_component_index].value;
-					auto other_current_type = from_archetype._type_data[other_component_index].value;
-					if (own_current_type == other_current_type)
+					if (target_component_index == target._type_data.size()
+					    || _type_data[own_component_index].value < target._type_data[target_component_index].value)
 					{
-						// copy component data over
-						rtt_vector &source_component_vector = from_archetype._component_data[other_component_index];
-						rtt_vector &target_component_vector = _component_data[own_component_index];
-						
-						void *source_data = source_component_vector[in_archetype_index];
-						void *target_data = target_component_vector[own_archetype_index];
-						std::memcpy(target_data, source_data, target_component_vector.sizeof_elements());
+						// component is not part of the target archetype
+						transition.destroyed_columns.push_back(_columns[own_component_index]);
+						++own_component_index;
+					}
+					else if (_type_data[own_component_index].value == target._type_data[target_component_index].value)
+					{
+						const chunk_column &own_column = _columns[own_component_index];
+						transition.moved_columns.push_back({own_column.offset, target._columns[target_component_index].offset, own_column.element_size});
 						
-						++other_component_index;
 						++own_component_index;
+						++target_component_index;
 					}
 					else
 					{
-						if (own_current_type > other_current_type)
-						{
-							// increase other_component_index
-							++other_component_index;
-							continue;
-						}
-						else
-						{
-							++own_component_index;;
-							continue;
-						}
+						++target_component_index;
 					}
 				}
 				
-				entity swapped_entity = from_archetype.remove_entity(in_archetype_index);
-				return {own_archetype_index, swapped_entity};
+				return transition;
+			}
+			
+			/// \return the cached transition for adding added_type to this archetype or nullptr if there is none yet
+			[[nodiscard]]
+			const archetype_transition *find_add_edge(type_id added_type) const
+			{
+				auto found = _add_edges.find(added_type);
+				return found == _add_edges.end() ? nullptr : &found->second;
+			}
+			
+			/// \return the cached transition for removing removed_type from this archetype or nullptr if there is none yet
+			[[nodiscard]]
+			const archetype_transition *find_remove_edge(type_id removed_type) const
+			{
+				auto found = _remove_edges.find(removed_type);
+				return found == _remove_edges.end() ? nullptr : &found->second;
+			}
+			
+			/// \return the cached transition into the archetype with the given index or nullptr if there is none yet
+			[[nodiscard]]
+			const archetype_transition *find_transition_to(std::size_t target_archetype_index) const
+			{
+				auto found = _transitions.find(target_archetype_index);
+				return found == _transitions.end() ? nullptr : &found->second;
+			}
+			
+			const archetype_transition &cache_add_edge(type_id added_type, const archetype_internal &target, std::size_t target_archetype_index)
+			{
+				return _add_edges.insert_or_assign(added_type, create_transition_to(target, target_archetype_index)).first->second;
+			}
+			
+			const archetype_transition &cache_remove_edge(type_id removed_type, const archetype_internal &target, std::size_t target_archetype_index)
+			{
+				return _remove_edges.insert_or_assign(removed_type, create_transition_to(target, target_archetype_index)).first->second;
+			}
+			
+			const archetype_transition &cache_transition_to(const archetype_internal &target, std::size_t target_archetype_index)
+			{
+				return _transitions.insert_or_assign(target_archetype_index, create_transition_to(target, target_archetype_index)).first->second;
 			}
 			
 			template<typename ...t_added_components>
@@ -118,25 +397,350 @@ namespace arch
 			[[nodiscard]]
 			std::size_t size() const
 			{
-				return _entities.size();
+				return _size;
+			}
+			
+			/// \return the maximum number of entities a single chunk can contain
+			[[nodiscard]]
+			std::size_t chunk_capacity() const
+			{
+				return _chunk_capacity;
+			}
+			
+			[[nodiscard]]
+			std::size_t chunk_count() const
+			{
+				return _chunks.size();
+			}
+			
+			/// all chunks of the archetype. every chunk except for the last one is filled up to chunk_capacity()
+			[[nodiscard]]
+			std::span<const chunk> chunks() const
+			{
+				return {_chunks};
+			}
+			
+			/// \return the entities stored in the chunk with the given index
+			[[nodiscard]]
+			std::span<const entity> chunk_entities(std::size_t chunk_index) const
+			{
+				const chunk &of_chunk = _chunks[chunk_index];
+				return {reinterpret_cast<const entity *>(of_chunk.data), of_chunk.size};
+			}
+			
+			/// \return the beginning of the column_index'th column inside the chunk with the given index
+			[[nodiscard]]
+			std::byte *chunk_column_data(std::size_t chunk_index, std::size_t column_index)
+			{
+				return _chunks[chunk_index].data + _columns[column_index].offset;
+			}
+			
+			/// \return the beginning of the column_index'th column inside the chunk with the given index
+			[[nodiscard]]
+			const std::byte *chunk_column_data(std::size_t chunk_index, std::size_t column_index) const
+			{
+				return _chunks[chunk_index].data + _columns[column_index].offset;
+			}
+			
+			/// \return the tick at which the column_index'th column of the chunk with the given index was last written to
+			[[nodiscard]]
+			change_tick column_change_tick(std::size_t chunk_index, std::size_t column_index) const
+			{
+				arch_assert_internal(column_index < _columns.size());
+				return reinterpret_cast<const change_tick *>(_chunks[chunk_index].data + _change_ticks_offset)[column_index];
+			}
+			
+			/// \return the tick at which entities were last added to or removed from the chunk with the given index
+			[[nodiscard]]
+			change_tick entities_change_tick(std::size_t chunk_index) const
+			{
+				return reinterpret_cast<const change_tick *>(_chunks[chunk_index].data + _change_ticks_offset)[_columns.size()];
+			}
+			
+			/// \return the change ticks of all columns of the chunk with the given index, followed by the one of its entity ids
+			[[nodiscard]]
+			std::span<change_tick> chunk_change_ticks(std::size_t chunk_index)
+			{
+				make_chunk_writable(_chunks[chunk_index]);
+				return {reinterpret_cast<change_tick *>(_chunks[chunk_index].data + _change_ticks_offset), _columns.size() + 1};
+			}
+			
+			[[nodiscard]]
+			std::span<const change_tick> chunk_change_ticks(std::size_t chunk_index) const
+			{
+				return {reinterpret_cast<const change_tick *>(_chunks[chunk_index].data + _change_ticks_offset), _columns.size() + 1};
+			}
+			
+			/// Changes the number of chunks while restoring a snapshot. Added chunks are empty and uninitialized, the components of removed chunks
+			/// get destroyed
+			void set_chunk_count(std::size_t n_chunks)
+			{
+				while (_chunks.size() > n_chunks)
+				{
+					_size -= _chunks.back().size;
+					release_chunk(_chunks.back());
+					_chunks.pop_back();
+				}
+				while (_chunks.size() < n_chunks)
+				{
+					_chunks.push_back(allocate_chunk());
+				}
+			}
+			
+			/// Sets the number of entities inside a chunk while restoring a snapshot, without touching its rows. Once all chunks are restored,
+			/// every chunk except the last one has to be full. The chunk can be written to afterwards
+			void set_chunk_size(std::size_t chunk_index, std::size_t size)
+			{
+				arch_assert_external(size <= _chunk_capacity);
+				
+				make_chunk_writable(_chunks[chunk_index]);
+				_size = _size - _chunks[chunk_index].size + size;
+				_chunks[chunk_index].size = size;
 			}
 			
+			/// number of bytes every chunk of this archetype occupies
 			[[nodiscard]]
-			std::span<rtt_vector> component_vectors()
+			std::size_t chunk_bytes() const
 			{
-				return _component_data;
+				return _chunk_bytes;
 			}
 			
 			[[nodiscard]]
-			std::span<const rtt_vector> component_vectors() const
+			std::size_t chunk_alignment() const
 			{
-				return _component_data;
+				return _chunk_alignment;
 			}
 			
+			/// \return where the components live inside each chunk, in the order of get_contained_types
 			[[nodiscard]]
-			std::span<const entity> entities() const
+			std::span<const chunk_column> columns() const
+			{
+				return {_columns};
+			}
+			
+			/// copies the chunk with the given index into image, which needs to be chunk_bytes() large. bytes outside of the rows in use are zeroed
+			void copy_chunk_image(std::size_t chunk_index, std::byte *image) const
+			{
+				const chunk &source = _chunks[chunk_index];
+				std::memset(image, 0, _chunk_bytes);
+				std::memcpy(image, source.data, source.size * sizeof(entity));
+				for (const chunk_column &column: _columns)
+				{
+					std::memcpy(image + column.offset, source.data + column.offset, source.size * column.element_size);
+				}
+				std::memcpy(image + _change_ticks_offset, source.data + _change_ticks_offset, (_columns.size() + 1) * sizeof(change_tick));
+			}
+			
+			/// Appends a chunk whose memory is owned by someone else, for example a memory mapped snapshot. data has to be laid out like the chunks of
+			/// this archetype and stay valid for the lifetime of the archetype. The archetype never deallocates it
+			void adopt_chunk(std::byte *data, std::size_t n_entities)
+			{
+				arch_assert_external(reinterpret_cast<std::uintptr_t>(data) % _chunk_alignment == 0);
+				arch_assert_external(n_entities != 0 && n_entities <= _chunk_capacity);
+				// only the last chunk may be partially filled
+				arch_assert_external(_chunks.empty() || _chunks.back().size == _chunk_capacity);
+				
+				_chunks.push_back({data, n_entities, true});
+				_size += n_entities;
+			}
+			
+			/// remembers that the column_index'th column of the chunk with the given index gets written to at the current tick. Has to be called
+			/// before the column gets written to, since chunks shared with a fork get copied here
+			void mark_column_changed(std::size_t chunk_index, std::size_t column_index)
+			{
+				mark_column_changed(chunk_index, column_index, current_change_tick());
+			}
+			
+			/// like mark_column_changed, but stamps the column with the given tick instead of the current one
+			void mark_column_changed(std::size_t chunk_index, std::size_t column_index, change_tick tick)
 			{
-				return {_entities};
+				arch_assert_internal(column_index < _columns.size());
+				make_chunk_writable(_chunks[chunk_index]);
+				reinterpret_cast<change_tick *>(_chunks[chunk_index].data + _change_ticks_offset)[column_index] = tick;
+			}
+			
+			/// lets the archetype read the tick of its world. entities added to or moved inside a chunk mark all of its columns as changed
+			void set_change_tick_source(const std::atomic<change_tick> *source)
+			{
+				_change_tick_source = source;
+			}
+			
+			/// sets where the memory of chunks comes from. has to be thread safe if the archetype gets forked
+			void set_chunk_resource(std::pmr::memory_resource *resource)
+			{
+				arch_assert_internal(_chunks.empty());
+				_chunk_resource = resource;
+			}
+			
+			[[nodiscard]]
+			std::pmr::memory_resource *chunk_resource() const
+			{
+				return _chunk_resource;
+			}
+			
+			/// Lets chunks allocated from now on come from resource. Chunks allocated before remember the resource they have to be returned to
+			void change_chunk_resource(std::pmr::memory_resource *resource)
+			{
+				remember_chunk_resource(_chunks);
+				_chunk_resource = resource;
+			}
+			
+			/// lets chunks of this archetype stored elsewhere, for example in a captured state, remember the current chunk resource. has to be
+			/// called for them before changing it
+			void remember_chunk_resource(std::span<chunk> chunks) const
+			{
+				for (chunk &current_chunk: chunks)
+				{
+					if (current_chunk.resource == nullptr && not current_chunk.borrowed)
+					{
+						current_chunk.resource = _chunk_resource;
+					}
+				}
+			}
+			
+			/// Lets this empty archetype use the chunks of source, which needs to have the same layout. The memory of the chunks is shared until
+			/// either archetype writes to a chunk, which then gets copied
+			void share_chunks_of(archetype_internal &source)
+			{
+				arch_assert_internal(_chunks.empty() && _chunk_bytes == source._chunk_bytes);
+				
+				_chunks.reserve(source._chunks.size());
+				for (chunk &shared: source._chunks)
+				{
+					_chunks.push_back(share_chunk(shared));
+				}
+				_size = source._size;
+			}
+			
+			/// copies all chunks that are still shared with a fork or a captured state, see make_chunk_writable
+			void make_chunks_writable()
+			{
+				for (chunk &shared: _chunks)
+				{
+					make_chunk_writable(shared);
+				}
+			}
+			
+			/// Shares the chunks of this archetype with captured, which contains the chunks of an earlier capture and gets updated in place.
+			/// Chunks that were not written to since then are still shared and stay untouched
+			void capture_chunks(std::vector<chunk> &captured)
+			{
+				for (std::size_t i = 0; i < _chunks.size(); ++i)
+				{
+					if (i == captured.size())
+					{
+						captured.push_back(share_chunk(_chunks[i]));
+					}
+					else if (captured[i].data != _chunks[i].data)
+					{
+						release_chunk(captured[i]);
+						captured[i] = share_chunk(_chunks[i]);
+					}
+				}
+				release_chunks_after(captured, _chunks.size());
+			}
+			
+			/// Replaces the entities of this archetype with the ones inside the captured chunks, which stay shared with captured. Only chunks that
+			/// were written to since the capture get replaced
+			void restore_chunks(std::span<chunk> captured)
+			{
+				for (std::size_t i = 0; i < captured.size(); ++i)
+				{
+					if (i == _chunks.size())
+					{
+						_chunks.push_back(share_chunk(captured[i]));
+					}
+					else if (_chunks[i].data != captured[i].data)
+					{
+						release_chunk(_chunks[i]);
+						_chunks[i] = share_chunk(captured[i]);
+					}
+				}
+				release_chunks_after(_chunks, captured.size());
+				_size = _chunks.empty() ? 0 : (_chunks.size() - 1) * _chunk_capacity + _chunks.back().size;
+			}
+			
+			/// releases captured chunks created by capture_chunks
+			void release_chunks(std::vector<chunk> &captured)
+			{
+				release_chunks_after(captured, 0);
+			}
+			
+			/// Moves all entities of source, which needs to have the same layout, into this archetype and leaves source empty. Rows from the end
+			/// of source fill up the last chunk of this archetype, the other chunks of source are taken over without touching their components.
+			/// Every moved entity gets replaced by remapped[id]
+			/// \return the index of the first moved entity inside this archetype, the other entities follow
+			std::size_t take_entities_of(archetype_internal &source, std::span<const entity> remapped)
+			{
+				arch_assert_internal(&source != this && _chunk_bytes == source._chunk_bytes && _columns.size() == source._columns.size());
+				
+				const std::size_t first_index = _size;
+				// only the last chunk may be partially filled
+				while (source._size != 0 && not _chunks.empty() && _chunks.back().size != _chunk_capacity)
+				{
+					chunk &last_chunk = _chunks.back();
+					chunk &source_chunk = source._chunks.back();
+					make_chunk_writable(last_chunk);
+					source.make_chunk_writable(source_chunk);
+					const std::size_t n_moved = std::min(_chunk_capacity - last_chunk.size, source_chunk.size);
+					const std::size_t first_moved = source_chunk.size - n_moved;
+					
+					const entity *moved_entities = reinterpret_cast<const entity *>(source_chunk.data) + first_moved;
+					entity *target_entities = reinterpret_cast<entity *>(last_chunk.data) + last_chunk.size;
+					for (std::size_t i = 0; i < n_moved; ++i)
+					{
+						target_entities[i] = remapped[moved_entities[i].id];
+					}
+					for (const chunk_column &column: _columns)
+					{
+						std::memcpy(last_chunk.data + column.offset + last_chunk.size * column.element_size,
+						            source_chunk.data + column.offset + first_moved * column.element_size,
+						            n_moved * column.element_size);
+					}
+					last_chunk.size += n_moved;
+					_size += n_moved;
+					mark_chunk_changed(last_chunk);
+					
+					source_chunk.size -= n_moved;
+					source._size -= n_moved;
+					if (source_chunk.size == 0)
+					{
+						source.deallocate_chunk(source_chunk);
+						source._chunks.pop_back();
+					}
+				}
+				
+				_chunks.reserve(_chunks.size() + source._chunks.size());
+				for (chunk &taken: source._chunks)
+				{
+					source.make_chunk_writable(taken);
+					if (taken.resource == nullptr)
+					{
+						taken.resource = source._chunk_resource;
+					}
+					
+					entity *taken_entities = reinterpret_cast<entity *>(taken.data);
+					for (std::size_t i = 0; i < taken.size; ++i)
+					{
+						taken_entities[i] = remapped[taken_entities[i].id];
+					}
+					mark_chunk_changed(taken);
+					_size += taken.size;
+					_chunks.push_back(taken);
+				}
+				source._chunks.clear();
+				source._size = 0;
+				
+				return first_index;
+			}
+			
+			[[nodiscard]]
+			entity entity_at(std::size_t index) const
+			{
+				arch_assert_external(index < _size);
+				
+				auto [chunk_index, in_chunk_index] = locate(index);
+				return reinterpret_cast<const entity *>(_chunks[chunk_index].data)[in_chunk_index];
 			}
 			
 			[[nodiscard]]
@@ -145,6 +749,13 @@ namespace arch
 				return {_type_data};
 			}
 			
+			/// \return a bitset of the dense indices of all contained types
+			[[nodiscard]]
+			const component_mask &get_component_mask() const
+			{
+				return _component_mask;
+			}
+			
 			[[nodiscard]]
 			bool contains_type(type_id type) const
 			{
@@ -163,125 +774,351 @@ namespace arch
 				return false;
 			}
 			
+			/// \return the index of the column containing component_type or no_column if this archetype does not contain that type
+			[[nodiscard]]
+			std::size_t column_index_of(type_id component_type) const
+			{
+				for (std::size_t i = 0; i < _type_data.size(); ++i)
+				{
+					if (_type_data[i] == component_type)
+					{
+						return i;
+					}
+				}
+				
+				return no_column;
+			}
+			
+			/// \return the component of the entity with the given index inside the column_index'th column
+			[[nodiscard]]
+			void *get_column_data(std::size_t component_index, std::size_t column_index)
+			{
+				arch_assert_external(column_index < _columns.size());
+				arch_assert_external(component_index < _size);
+				
+				auto [chunk_index, in_chunk_index] = locate(component_index);
+				const chunk_column &column = _columns[column_index];
+				return _chunks[chunk_index].data + column.offset + in_chunk_index * column.element_size;
+			}
+			
 			[[nodiscard]]
 			void *get_component_data(std::size_t component_index, type_id component_type)
 			{
-				auto *comp_vector = get_component_data_of(component_type);
-				arch_assert_external(comp_vector != nullptr);
-				arch_assert_external(component_index < comp_vector->size());
+				std::size_t column_index = column_index_of(component_type);
+				arch_assert_external(column_index != no_column);
+				arch_assert_external(component_index < _size);
 				
-				return (*comp_vector)[component_index];
+				auto [chunk_index, in_chunk_index] = locate(component_index);
+				const chunk_column &column = _columns[column_index];
+				return _chunks[chunk_index].data + column.offset + in_chunk_index * column.element_size;
 			}
 			
 			[[nodiscard]]
 			const void *get_component_data(std::size_t component_index, type_id component_type) const
 			{
-				auto *comp_vector = get_component_data_of(component_type);
-				arch_assert_external(comp_vector != nullptr);
-				arch_assert_external(component_index < comp_vector->size());
+				std::size_t column_index = column_index_of(component_type);
+				arch_assert_external(column_index != no_column);
+				arch_assert_external(component_index < _size);
 				
-				return (*comp_vector)[component_index];
+				auto [chunk_index, in_chunk_index] = locate(component_index);
+				const chunk_column &column = _columns[column_index];
+				return _chunks[chunk_index].data + column.offset + in_chunk_index * column.element_size;
 			}
 		
+		public:
+			static constexpr std::size_t no_column = std::numeric_limits<std::size_t>::max();
+		
 		private:
 			template<typename t_add_component>
 			void set_component(std::size_t entity_index, t_add_component &&to_add)
 			{
 				constexpr type_id curr_type = id_of<t_add_component>();
 				
-				// TODO: theoretically it should be possible to reuse component_vectors_index for different invocations
-				std::size_t component_vectors_index = 0;
-				while (curr_type.value != _type_data[component_vectors_index].value)
+				const std::size_t column_index = column_index_of(curr_type);
+				mark_column_changed(entity_index / _chunk_capacity, column_index);
+				void *component_data = get_column_data(entity_index, column_index);
+				std::construct_at(reinterpret_cast<std::remove_cvref_t<t_add_component> *>(component_data), arch_fwd(to_add));
+			}
+			
+			/// \return the index of the chunk and the index inside that chunk of the entity with the given index
+			[[nodiscard]]
+			std::pair<std::size_t, std::size_t> locate(std::size_t index) const
+			{
+				return {index / _chunk_capacity, index % _chunk_capacity};
+			}
+			
+			/// Moves the last entity into the place of index without calling any destructors and shrinks the archetype by one entity
+			/// \return the moved entity
+			entity fill_gap(std::size_t index)
+			{
+				auto [chunk_index, in_chunk_index] = locate(index);
+				chunk &target_chunk = _chunks[chunk_index];
+				chunk &last_chunk = _chunks.back();
+				make_chunk_writable(target_chunk);
+				make_chunk_writable(last_chunk);
+				const std::size_t last_in_chunk_index = last_chunk.size - 1;
+				
+				entity *last_chunk_entities = reinterpret_cast<entity *>(last_chunk.data);
+				entity swapped_entity = last_chunk_entities[last_in_chunk_index];
+				
+				if (&target_chunk != &last_chunk || in_chunk_index != last_in_chunk_index)
+				{
+					reinterpret_cast<entity *>(target_chunk.data)[in_chunk_index] = swapped_entity;
+					for (const chunk_column &column: _columns)
+					{
+						std::memcpy(target_chunk.data + column.offset + in_chunk_index * column.element_size,
+						            last_chunk.data + column.offset + last_in_chunk_index * column.element_size,
+						            column.element_size);
+					}
+					mark_chunk_changed(target_chunk);
+				}
+				
+				--last_chunk.size;
+				--_size;
+				mark_entities_changed(last_chunk);
+				if (last_chunk.size == 0)
 				{
-					++component_vectors_index;
+					deallocate_chunk(last_chunk);
+					_chunks.pop_back();
 				}
 				
-				void *component_data = _component_data[component_vectors_index][entity_index];
-				std::construct_at(reinterpret_cast<t_add_component *>(component_data), arch_fwd(to_add));
+				return swapped_entity;
+			}
+			
+			[[nodiscard]]
+			change_tick current_change_tick() const
+			{
+				return _change_tick_source == nullptr ? 0 : _change_tick_source->load(std::memory_order_relaxed);
+			}
+			
+			/// marks all columns and the entity ids of the chunk as changed
+			void mark_chunk_changed(chunk &changed)
+			{
+				std::fill_n(reinterpret_cast<change_tick *>(changed.data + _change_ticks_offset), _columns.size() + 1, current_change_tick());
+			}
+			
+			void mark_entities_changed(chunk &changed)
+			{
+				reinterpret_cast<change_tick *>(changed.data + _change_ticks_offset)[_columns.size()] = current_change_tick();
+			}
+			
+			[[nodiscard]]
+			chunk allocate_chunk()
+			{
+				if (_chunk_resource == nullptr)
+				{
+					_chunk_resource = std::pmr::get_default_resource();
+				}
+				
+				return {reinterpret_cast<std::byte *>(_chunk_resource->allocate(_chunk_bytes, _chunk_alignment)), 0};
+			}
+			
+			void deallocate_chunk(chunk &to_deallocate)
+			{
+				arch_assert_internal(to_deallocate.owners == nullptr);
+				
+				if (not to_deallocate.borrowed)
+				{
+					std::pmr::memory_resource *resource = to_deallocate.resource == nullptr ? _chunk_resource : to_deallocate.resource;
+					resource->deallocate(to_deallocate.data, _chunk_bytes, _chunk_alignment);
+				}
+				to_deallocate.data = nullptr;
+			}
+			
+			/// gives up the ownership of a chunk. its components get destroyed unless a fork still uses them
+			void release_chunk(chunk &released)
+			{
+				if (released.owners != nullptr)
+				{
+					// the last owner has to see all writes of the others before destroying the chunk
+					if (released.owners->count.fetch_sub(1, std::memory_order_acq_rel) != 1)
+					{
+						released.data = nullptr;
+						released.owners = nullptr;
+						return;
+					}
+					delete released.owners;
+					released.owners = nullptr;
+				}
+				
+				for (const chunk_column &column: _columns)
+				{
+					column.destructor.value(released.data + column.offset, released.size);
+				}
+				deallocate_chunk(released);
+			}
+			
+			/// \return a chunk using the same memory as shared, which becomes read only for both
+			[[nodiscard]]
+			chunk share_chunk(chunk &shared)
+			{
+				if (shared.owners == nullptr)
+				{
+					for (const chunk_column &column: _columns)
+					{
+						arch_assert_internal(column.destructor.copy != nullptr); // the world only shares copyable chunks
+					}
+					shared.owners = new chunk_owners{1};
+				}
+				shared.owners->count.fetch_add(1, std::memory_order_relaxed);
+				return shared;
+			}
+			
+			/// releases all chunks starting at first_released and removes them from chunks
+			template<typename t_chunks>
+			void release_chunks_after(t_chunks &chunks, std::size_t first_released)
+			{
+				for (std::size_t i = first_released; i < chunks.size(); ++i)
+				{
+					release_chunk(chunks[i]);
+				}
+				chunks.resize(std::min(chunks.size(), first_released));
+			}
+			
+			/// copies a chunk whose memory is shared with a fork, so that it can be written to
+			void make_chunk_writable(chunk &target)
+			{
+				if (target.owners == nullptr) [[likely]]
+				{
+					return;
+				}
+				if (target.owners->count.load(std::memory_order_acquire) == 1)
+				{
+					// all forks released the chunk already
+					delete target.owners;
+					target.owners = nullptr;
+					return;
+				}
+				
+				chunk copy = allocate_chunk();
+				copy.size = target.size;
+				std::memcpy(copy.data, target.data, target.size * sizeof(entity));
+				for (const chunk_column &column: _columns)
+				{
+					arch_assert_internal(column.destructor.copy != nullptr);
+					column.destructor.copy(copy.data + column.offset, target.data + column.offset, target.size);
+				}
+				std::memcpy(copy.data + _change_ticks_offset, target.data + _change_ticks_offset, (_columns.size() + 1) * sizeof(change_tick));
+				
+				release_chunk(target);
+				target = copy;
+			}
+			
+			/// calculates how many entities fit into a chunk and where each column is placed. may only be called while the archetype is empty
+			void update_layout()
+			{
+				arch_assert_internal(_size == 0);
+				
+				std::size_t row_size = sizeof(entity);
+				_chunk_alignment = chunk_column_alignment;
+				for (const chunk_column &column: _columns)
+				{
+					row_size += column.element_size;
+					_chunk_alignment = std::max(_chunk_alignment, column.alignment);
+				}
+				
+				std::size_t capacity = std::max<std::size_t>(default_chunk_size / row_size, 1);
+				while (capacity > 1 && place_columns(capacity) > default_chunk_size)
+				{
+					--capacity;
+				}
+				
+				_chunk_capacity = capacity;
+				_chunk_bytes = std::max(place_columns(capacity), default_chunk_size);
+			}
+			
+			/// sets the offsets of all columns for chunks containing capacity entities
+			/// \return the number of bytes needed for such a chunk
+			std::size_t place_columns(std::size_t capacity)
+			{
+				std::size_t offset = align_up(capacity * sizeof(entity), chunk_column_alignment);
+				for (chunk_column &column: _columns)
+				{
+					column.offset = align_up(offset, column.alignment);
+					offset = align_up(column.offset + capacity * column.element_size, chunk_column_alignment);
+				}
+				
+				// one change tick per column and one for the entity ids follow behind the last column
+				_change_ticks_offset = offset;
+				return align_up(offset + (_columns.size() + 1) * sizeof(change_tick), chunk_column_alignment);
 			}
 		
 		public:
 			/// helper struct to modify what the archetype can contain. IMPORTANT: while a modifer is alive the modified archetype may not be used since
-			/// its component array could be in invalid positions. if you still need to get component data while a modifer is alive make sure you call
-			/// sort_types() first.
+			/// its columns could be in invalid positions. Archetypes may only be modified while they do not contain any entities.
 			struct archetype_modifier
 			{
 			public:
-				constexpr explicit archetype_modifier(archetype_internal &to_modify)
+				explicit archetype_modifier(archetype_internal &to_modify)
 						: _archetype(to_modify)
 				{
+					arch_assert_internal(to_modify.size() == 0);
 				}
 				
 				~archetype_modifier()
 				{
-					// maybe not always necessary, but won't hurt since in sorted case we will only iterate over all component vectors once
+					// maybe not always necessary, but won't hurt since in sorted case we will only iterate over all columns once
 					sort_types();
+					_archetype.update_layout();
+					
+					// cached transitions depend on the column layout
+					_archetype._add_edges.clear();
+					_archetype._remove_edges.clear();
+					_archetype._transitions.clear();
 				}
 				
 				template<typename ...Ts>
 				void init(std::pmr::memory_resource &resource)
 				{
-					_archetype._type_data = {info_of<Ts>()...};
-					_archetype._component_data = {det::rtt_vector::of<Ts>(resource)...};
+					_archetype._type_data = std::pmr::vector<type_id>(std::initializer_list<type_id>{id_of<Ts>()...}, &resource);
+					_archetype._columns = std::pmr::vector<chunk_column>(std::initializer_list<chunk_column>{
+							{sizeof(Ts), column_alignment_of(alignof(Ts)), multi_destructor_of<Ts>()}...},
+					                                                     &resource);
+					_archetype._component_mask = mask_of<Ts...>();
 					init_entities(resource);
 				}
 				
 				void copy_settings_from(const archetype_internal &other_archetype, std::pmr::memory_resource &resource)
 				{
-					_archetype._type_data = other_archetype._type_data;
-					
-					_archetype._component_data.reserve(other_archetype._component_data.size());
-					for (const rtt_vector &other_vec: other_archetype._component_data)
-					{
-						_archetype._component_data.emplace_back(arch_fwd(det::rtt_vector::copy_settings_from(other_vec, resource)));
-					}
+					_archetype._type_data = std::pmr::vector<type_id>(other_archetype._type_data, &resource);
+					_archetype._columns = std::pmr::vector<chunk_column>(other_archetype._columns, &resource);
+					_archetype._component_mask = other_archetype._component_mask;
 					init_entities(resource);
 				}
 				
-				void init_components(std::pmr::memory_resource &resource, std::span<const type_id> type_datas,
-				                     std::span<const det::rtt_vector> component_datas)
-				{
-					arch_assert_internal(type_datas.size() == component_datas.size());
-					
-					_archetype._type_data = std::pmr::vector<type_id>(type_datas.begin(), type_datas.end(), &resource);
-					
-					_archetype._component_data = std::pmr::vector<det::rtt_vector>(&resource);
-					_archetype._component_data.reserve(component_datas.size());
-					for (const auto &curr_components: component_datas)
-					{
-						_archetype._component_data.emplace_back(det::rtt_vector(resource, curr_components.sizeof_elements(), curr_components.destructor()));
-					}
-				}
-				
-				/// initializes the archetypes entity array. usually only needs to be called once in the lifetime of an archetype
+				/// initializes the archetypes chunk storage. usually only needs to be called once in the lifetime of an archetype
 				void init_entities(std::pmr::memory_resource &resource)
 				{
-					_archetype._entities = std::pmr::vector<entity>(&resource);
+					_archetype._chunks = std::pmr::vector<chunk>(&resource);
+					_archetype._add_edges = edge_map(&resource);
+					_archetype._remove_edges = edge_map(&resource);
+					_archetype._transitions = std::pmr::unordered_map<std::size_t, archetype_transition>(&resource);
+					_archetype._resource = &resource;
 				}
 				
 				/// adds a new type to the archetype
 				template<typename T>
 				void add_type(std::pmr::memory_resource &resource)
 				{
-					if (_archetype.contains_type(id_of<T>()))
-					{
-						return;
-					}
-					
-					_archetype._type_data.emplace_back(id_of<T>());
-					_archetype._component_data.emplace_back(det::rtt_vector::of<T>(resource));
+					add_type(resource, info_of<T>(), multi_destructor_of<T>());
 				}
 				
-				/// adds a new type to the archetype
+				/// adds a new type to the archetype. Throws std::length_error if the type would exceed ARCH_MAX_COMPONENT_TYPES, see component_registry
 				void add_type(std::pmr::memory_resource &resource, type_info component_info, multi_destructor destruct_n)
 				{
+					if (_archetype._resource == nullptr)
+					{
+						init_entities(resource);
+					}
+					
 					if (_archetype.contains_type(component_info.id))
 					{
 						return;
 					}
 					
+					_archetype._component_mask.set(component_registry::index_of(component_info.id));
 					_archetype._type_data.emplace_back(component_info.id);
-					_archetype._component_data.emplace_back(det::rtt_vector(resource, component_info.size, destruct_n));
+					_archetype._columns.push_back({component_info.size, column_alignment_of(component_info.alignment), destruct_n});
 				}
 				
 				void remove_type(type_id to_remove)
@@ -291,20 +1128,21 @@ namespace arch
 						return;
 					}
 					
+					_archetype._component_mask.reset(component_registry::index_of(to_remove));
 					for (std::size_t i = 0; i < _archetype._type_data.size(); ++i)
 					{
 						if (to_remove == _archetype._type_data[i])
 						{
 							_archetype._type_data[i] = _archetype._type_data.back();
-							_archetype._component_data[i] = std::move(_archetype._component_data.back());
+							_archetype._columns[i] = _archetype._columns.back();
 							
 							_archetype._type_data.pop_back();
-							_archetype._component_data.pop_back();
+							_archetype._columns.pop_back();
 						}
 					}
 				}
 				
-				/// sorts all internal component vectors and type id vectors
+				/// sorts all internal columns and type id vectors
 				void sort_types()
 				{
 					// use basic insertion sort as we only deal with small array sizes that are sometimes nearly sorted
@@ -331,24 +1169,15 @@ namespace arch
 						return;
 					}
 					
-					{
-						auto temp = _archetype._type_data[place1];
-						_archetype._type_data[place1] = _archetype._type_data[place2];
-						_archetype._type_data[place2] = temp;
-					}
-					{
-						rtt_vector temp = _archetype._component_data[place1];
-						_archetype._component_data[place1] = std::move(_archetype._component_data[place2]);
-						_archetype._component_data[place2] = std::move(temp);
-					}
+					std::swap(_archetype._type_data[place1], _archetype._type_data[place2]);
+					std::swap(_archetype._columns[place1], _archetype._columns[place2]);
 				}
 			
 			private:
 				archetype_internal &_archetype;
 			};
 			
-			///IMPORTANT: while a modifer is alive the modified archetype may not be used since its component array could be in invalid positions. if you
-			/// need to get component data while a modifer is alive despite this make sure you call sort_types() first.
+			///IMPORTANT: while a modifer is alive the modified archetype may not be used since its columns could be in invalid positions.
 			[[nodiscard]]
 			archetype_modifier modify_archetype()
 			{
@@ -356,38 +1185,34 @@ namespace arch
 			}
 		
 		protected:
-			[[nodiscard]]
-			det::rtt_vector *get_component_data_of(type_id component_type)
-			{
-				for (std::size_t i = 0; i < _type_data.size(); ++i)
-				{
-					if (_type_data[i] == component_type)
-					{
-						return &(_component_data[i]);
-					}
-				}
-				
-				return nullptr;
-			}
+			using edge_map = std::pmr::unordered_map<type_id, archetype_transition>;
 			
-			[[nodiscard]]
-			const det::rtt_vector *get_component_data_of(type_id component_type) const
-			{
-				for (std::size_t i = 0; i < _type_data.size(); ++i)
-				{
-					if (_type_data[i] == component_type)
-					{
-						return &(_component_data[i]);
-					}
-				}
-				
-				return nullptr;
-			}
-		
-		protected:
 			std::pmr::vector<type_id> _type_data;
-			std::pmr::vector<det::rtt_vector> _component_data;
-			std::pmr::vector<entity> _entities;
+			/// same types as _type_data, but as bitset for fast query matching
+			component_mask _component_mask{};
+			std::pmr::vector<chunk_column> _columns;
+			std::pmr::vector<chunk> _chunks;
+			
+			/// transitions into other archetypes when adding a single component
+			edge_map _add_edges;
+			/// transitions into other archetypes when removing a single component
+			edge_map _remove_edges;
+			/// transitions into other archetypes by their index, used when changing multiple components at once
+			std::pmr::unordered_map<std::size_t, archetype_transition> _transitions;
+			std::pmr::memory_resource *_resource{};
+			/// where chunks get allocated, shared with the forks of the world
+			std::pmr::memory_resource *_chunk_resource{};
+			
+			/// number of entities over all chunks
+			std::size_t _size = 0;
+			std::size_t _chunk_capacity = default_chunk_size / sizeof(entity);
+			std::size_t _chunk_bytes = default_chunk_size;
+			/// alignment of the chunks memory, equal to the largest alignment of all columns
+			std::size_t _chunk_alignment = chunk_column_alignment;
+			/// offset of the change ticks of the columns relative to the beginning of a chunk, in bytes
+			std::size_t _change_ticks_offset = 0;
+			/// tick of the owning world, written into the change ticks of a chunk whenever it is modified
+			const std::atomic<change_tick> *_change_tick_source = nullptr;
 		};
 	}
 	
@@ -395,10 +1220,24 @@ namespace arch
 	{
 	public:
 		using det::archetype_internal::size;
-		using det::archetype_internal::entities;
-		using det::archetype_internal::get_component_data;
+		using det::archetype_internal::chunk_count;
+		using det::archetype_internal::chunk_capacity;
+		using det::archetype_internal::chunks;
+		using det::archetype_internal::chunk_entities;
+		using det::archetype_internal::entity_at;
 		using det::archetype_internal::get_contained_types;
+		using det::archetype_internal::get_component_mask;
 		using det::archetype_internal::contains_type;
+		using det::archetype_internal::column_index_of;
+		using det::archetype_internal::column_change_tick;
+		
+		/// \return the component of the entity with the given index. Only readable, writes have to go through the world so that shared chunks get
+		/// copied and changed filters see them
+		[[nodiscard]]
+		const void *get_component_data(std::size_t component_index, type_id component_type) const
+		{
+			return internal().get_component_data(component_index, component_type);
+		}
 		
 		[[nodiscard]]
 		det::archetype_internal &internal()
@@ -3,131 +3,138 @@
 #include <vector>
 #include <span>
 #include <limits>
-#include <queue>
+#include <memory>
 #include <algorithm>
+#include <compare>
+#include <cstring>
+#include <memory_resource>
+#include <type_traits>
 
 #include "archetype.hpp"
 #include "world.hpp"
+#include "internal/byte_vector.hpp"
 
 namespace arch
 {
 	class entity_command_buffer
 	{
 	public:
+		/// largest alignment of the components that can be added or set, the alignment of the command stream
+		static constexpr std::size_t max_component_alignment = det::cache_line_size;
+		
+		/// \param buffer_size number of bytes reserved for recording commands up front
 		explicit entity_command_buffer(world &execution_world, std::size_t buffer_size = 128)
 				: _execution_world(execution_world),
-				  _memory_buffer(buffer_size)
+				  _command_stream(*std::pmr::get_default_resource())
+		{
+			_command_stream.reserve_bytes(buffer_size);
+		}
+		
+		entity_command_buffer(const entity_command_buffer &) = delete;
+		entity_command_buffer &operator=(const entity_command_buffer &) = delete;
+		
+		~entity_command_buffer()
 		{
-			// initialize commands after _memory_buffer
-			_commands = std::pmr::vector<entity_command>(&_memory_buffer);
+			reset();
 		}
 	
 	private:
 		enum class entity_command_type
 		{
-			// WARNING: ordering of the values here is important, as everything before create_entity should be batchable in execution
-			destroy_entity, // order first to optimize any other commands away
+			destroy_entity,
 			create_entity,
 			add_component,
 			remove_component,
 			set_component
 		};
 		
-		static constexpr bool IsBatchable(entity_command_type command_type)
-		{
-			return command_type != entity_command_type::add_component && command_type != entity_command_type::remove_component;
-		}
-		
-		struct add_command_data
-		{
-			template<typename t_component>
-			static add_command_data of(void *component_data)
-			{
-				return {component_data, det::multi_destructor_of<t_component>()};
-			}
-			
-			void *component_data;
-			// we need to keep destructors in case we will have to create a new archetype
-			det::multi_destructor destructor;
-		};
-		
+		/// Header of a command inside the command stream. Add and set commands store the component value right behind it
 		struct entity_command
 		{
-			entity_command(entity_command_type type, const entity &target, type_info component_type, void *command_args = nullptr)
-					: type(type),
-					  target(target),
-					  component_type(component_type),
-					  command_args(command_args)
-			{}
-			
 			entity_command_type type;
 			entity target;
 			type_info component_type;
-			void *command_args;
+			/// destroys the value of add and set commands
+			det::multi_destructor destructor;
+			/// key the command was recorded with, used to merge the sub-buffers of a parallel_entity_command_buffer
+			std::uint64_t sort_key;
+			/// offset of the component value from the beginning of the command
+			std::uint32_t value_offset;
+			/// bytes from the beginning of the command up to the end of its value
+			std::uint32_t size;
+			
+			[[nodiscard]]
+			bool has_value() const
+			{
+				return type == entity_command_type::add_component || type == entity_command_type::set_component;
+			}
+			
+			[[nodiscard]]
+			void *value()
+			{
+				return reinterpret_cast<std::byte *>(this) + value_offset;
+			}
 		};
 		
-		void execute_command(entity_command command)
+		[[nodiscard]]
+		static constexpr bool is_virtual_entity(entity target)
 		{
-			switch (command.type)
-			{
-				case entity_command_type::destroy_entity:
-					if (not is_target_virtual_entity(command))
-					{
-						_execution_world.destroy_entity(command.target);
-					}
-					break;
-				case entity_command_type::add_component:
-				{
-					add_command_data *command_data = reinterpret_cast<add_command_data *>(command.command_args);
-					_execution_world.add_component(command.target, command.component_type, command_data->component_data, command_data->destructor);
-					break;
-				}
-				case entity_command_type::remove_component:
-				{
-					_execution_world.remove_component(command.target, command.component_type.id);
-				}
-					break;
-				case entity_command_type::set_component:
-				{
-					void *component = _execution_world.get_component(command.target, command.component_type.id);
-					std::memcpy(component, command.command_args, command.component_type.size);
-					break;
-				}
-				default:
-					arch_assert_external(false); // unknown or invalid command that should have been executed in other ways
-					break;
-			}
+			return target.version == std::numeric_limits<version_t>::max();
 		}
 		
 		[[nodiscard]]
 		static constexpr bool is_target_virtual_entity(const entity_command &command)
 		{
-			return command.target.version == std::numeric_limits<version_t>::max();
+			return is_virtual_entity(command.target);
+		}
+		
+		/// appends a command to the command stream, followed by room for the component value of add and set commands
+		/// \return the memory the component value needs to be constructed in
+		void *record_command(entity_command_type type, entity target, type_info component_type, det::multi_destructor destructor)
+		{
+			// commands without a key would be ordered by the thread that happened to record them
+			arch_assert_external(_has_sort_key || not _requires_sort_key); // call set_sort_key before recording into a parallel_entity_command_buffer
+			
+			const std::size_t command_offset = det::align_up(_command_stream.byte_size(), alignof(entity_command));
+			std::size_t command_end = command_offset + sizeof(entity_command);
+			std::size_t value_offset = sizeof(entity_command);
+			
+			const bool has_value = type == entity_command_type::add_component || type == entity_command_type::set_component;
+			if (has_value)
+			{
+				// the typed recording functions reject over-aligned components at compile time
+				arch_assert_internal(component_type.alignment <= _command_stream.byte_alignment());
+				value_offset = det::align_up(command_end, component_type.alignment) - command_offset;
+				command_end = command_offset + value_offset + component_type.size;
+			}
+			
+			_command_stream.push_back_bytes(command_end - _command_stream.byte_size());
+			auto *command = new(_command_stream.get_bytes(command_offset)) entity_command{type, target, component_type, destructor, _sort_key,
+			                                                                             static_cast<std::uint32_t>(value_offset),
+			                                                                             static_cast<std::uint32_t>(command_end - command_offset)};
+			return command->value();
 		}
 	
 	public:
 		template<typename t_component>
 		void add_component(entity target, t_component &&component)
 		{
-			void *component_memory = _memory_buffer.allocate(sizeof(t_component), alignof(t_component));
-			new(component_memory) t_component(arch_fwd(component));
-			
-			void *add_data = _memory_buffer.allocate(sizeof(add_command_data), alignof(add_command_data));
-			new(add_data) add_command_data(arch_fwd(add_command_data::of<t_component>(component_memory)));
-			
-			_commands.emplace_back(entity_command_type::add_component, target, info_of<t_component>(), add_data);
+			using component_t = std::remove_cvref_t<t_component>;
+			static_assert(alignof(component_t) <= max_component_alignment, "the command stream can not hold components with a larger alignment");
+			void *value = record_command(entity_command_type::add_component, target, info_of<component_t>(), det::multi_destructor_of<component_t>());
+			new(value) component_t(arch_fwd(component));
 		}
 		
 		template<typename t_component>
 		void add_component(virtual_entity target, t_component &&component)
 		{
-			add_component<t_component>(from_virtual(target), arch_fwd(component));
+			add_component(from_virtual(target), arch_fwd(component));
 		}
 		
 		template<typename t_component>
 		void remove_component(entity target)
 		{
-			_commands.emplace_back(entity_command_type::remove_component, target, info_of<t_component>());
+			record_command(entity_command_type::remove_component, target, info_of<t_component>(), {});
 		}
 		
 		template<typename t_component>
@@ -139,16 +146,16 @@ namespace arch
 		template<typename t_component>
 		void set_component(entity target, t_component &&component)
 		{
-			void *component_memory = _memory_buffer.allocate(sizeof(t_component), alignof(t_component));
-			new(component_memory) t_component(arch_fwd(component));
-			
-			_commands.emplace_back(entity_command_type::set_component, target, info_of<t_component>(), component_memory);
+			using component_t = std::remove_cvref_t<t_component>;
+			static_assert(alignof(component_t) <= max_component_alignment, "the command stream can not hold components with a larger alignment");
+			void *value = record_command(entity_command_type::set_component, target, info_of<component_t>(), det::multi_destructor_of<component_t>());
+			new(value) component_t(arch_fwd(component));
 		}
 		
 		template<typename t_component>
 		void set_component(virtual_entity target, t_component &&component)
 		{
-			set_component<t_component>(from_virtual(target), arch_fwd(component));
+			set_component(from_virtual(target), arch_fwd(component));
 		}
 		
 		/// creates a temporary entity that will be truly created when the command buffer is ran
@@ -158,143 +165,424 @@ namespace arch
 			entity created_entity = {static_cast<entity_id_t>(n_created_entities), std::numeric_limits<version_t>::max()};
 			++n_created_entities;
 			
-			_commands.emplace_back(entity_command_type::create_entity, created_entity, type_info::none(), nullptr);
+			record_command(entity_command_type::create_entity, created_entity, type_info::none(), {});
 			return virtual_entity(created_entity.id);
 		}
 		
 		void destroy_entity(entity target)
 		{
-			_commands.emplace_back(entity_command_type::create_entity, target, type_info::none(), nullptr);
+			record_command(entity_command_type::destroy_entity, target, type_info::none(), {});
 		}
 		
 		void destroy_entity(virtual_entity target)
 		{
-			_commands.emplace_back(entity_command_type::create_entity, from_virtual(target), type_info::none(), nullptr);
+			record_command(entity_command_type::destroy_entity, from_virtual(target), type_info::none(), {});
+		}
+		
+		/// Sets the key of all commands recorded from now on. Only used when this buffer is part of a parallel_entity_command_buffer, commands get
+		/// played back ordered by their key there. The key should identify the piece of work that recorded the commands, for example the entity
+		/// that got processed. Buffers of a parallel_entity_command_buffer need a key before their first command after every run
+		void set_sort_key(std::uint64_t sort_key)
+		{
+			_sort_key = sort_key;
+			_has_sort_key = true;
 		}
 		
+		/// Executes all recorded commands. The commands of every entity get combined into a single change of its component set first. Entities
+		/// of the same archetype with the same change are then moved into their new archetype together, so that the target archetype is only
+		/// looked up once and the components get copied in runs of rows instead of one entity at a time.
+		/// The buffer is empty afterwards and reuses its memory for the next commands
 		void run()
+		{
+			collect_commands();
+			play_back();
+			clear_commands();
+		}
+		
+		/// Drops all recorded commands without executing them. The memory of the command stream stays reserved, so recording up to as many
+		/// commands as before does not allocate
+		void reset()
+		{
+			collect_commands();
+			for (entity_command *command: _command_order)
+			{
+				if (command->has_value())
+				{
+					command->destructor.value(command->value(), 1);
+				}
+			}
+			clear_commands();
+		}
+	
+		/// \return the number of bytes commands can occupy before recording needs to allocate
+		[[nodiscard]]
+		std::size_t reserved_bytes() const noexcept
+		{
+			return _command_stream.byte_capacity();
+		}
+	
+	private:
+		/// fills _command_order with all commands of the command stream, in the order they were recorded in
+		void collect_commands()
+		{
+			_command_order.clear();
+			std::size_t command_offset = 0;
+			while (command_offset < _command_stream.byte_size())
+			{
+				command_offset = det::align_up(command_offset, alignof(entity_command));
+				auto *command = reinterpret_cast<entity_command *>(_command_stream.get_bytes(command_offset));
+				_command_order.push_back(command);
+				command_offset += command->size;
+			}
+		}
+		
+		void clear_commands()
+		{
+			_command_stream.clear();
+			_command_order.clear();
+			n_created_entities = 0;
+			_sort_key = 0;
+			_has_sort_key = false;
+		}
+		
+		/// executes the commands of _command_order, moves or destroys their component values
+		void play_back()
 		{
 			optimize_entity_modification_order();
+			collect_entity_changes();
 			
-			const std::size_t iteration_end = _commands.size();
-			
-			// buffers for batching commands together
-			std::vector<type_info> added_types{};
-			std::vector<det::multi_destructor> added_destructors{};
-			std::vector<type_id> removed_types{};
+			// entities with equal changes end up next to each other, stable to create new entities in the order they were recorded in
+			std::stable_sort(_changes.begin(), _changes.end(), [this](const entity_change &lhs, const entity_change &rhs)
+			{
+				return compare_changes(lhs, rhs) < 0;
+			});
 			
-			for (std::size_t command_index = 0; command_index < iteration_end; ++command_index)
+			std::size_t group_begin = 0;
+			while (group_begin < _changes.size())
 			{
-				entity current_entity = _commands[command_index].target;
-				std::size_t same_entity_modifications_end = command_index;
-				while (same_entity_modifications_end + 1 < iteration_end
-				       && _commands[same_entity_modifications_end + 1].target == current_entity)
+				std::size_t group_end = group_begin + 1;
+				while (group_end < _changes.size() && compare_changes(_changes[group_begin], _changes[group_end]) == 0)
 				{
-					++same_entity_modifications_end;
+					++group_end;
 				}
 				
-				if (command_index == same_entity_modifications_end)
-				{
-					// only do one modification to entity, no batching needed
-					execute_command(_commands[command_index]);
-				}
-				else
+				apply_changes(group_begin, group_end);
+				group_begin = group_end;
+			}
+			
+			_changes.clear();
+			_added_components.clear();
+			_removed_types.clear();
+			_set_components.clear();
+		}
+		
+		/// a component value recorded by an add or set command, moved into the world with a memcpy
+		struct recorded_component
+		{
+			type_info type;
+			det::multi_destructor destructor;
+			void *data;
+		};
+		
+		/// all commands of a single entity, combined into one change of its component set
+		struct entity_change
+		{
+			entity target;
+			std::size_t source_archetype_index;
+			bool is_created;
+			/// components the entity does not have yet, as range inside _added_components sorted by type_id
+			std::size_t first_added;
+			std::size_t n_added;
+			/// as range inside _removed_types, sorted
+			std::size_t first_removed;
+			std::size_t n_removed;
+			/// components the entity already has and that get overwritten, as range inside _set_components
+			std::size_t first_set;
+			std::size_t n_set;
+		};
+		
+		void optimize_entity_modification_order()
+		{
+			// stable, so that the commands of every entity stay in the order they were recorded in
+			std::stable_sort(_command_order.begin(), _command_order.end(), [](const entity_command *lhs, const entity_command *rhs)
+			{
+				return lhs->target < rhs->target;
+			});
+		}
+		
+		/// fills _changes with one entry per entity and destroys the entities that have a destroy command
+		void collect_entity_changes()
+		{
+			std::size_t command_index = 0;
+			while (command_index < _command_order.size())
+			{
+				const entity current_entity = _command_order[command_index]->target;
+				const std::size_t first_added = _added_components.size();
+				const std::size_t first_removed = _removed_types.size();
+				const std::size_t first_set = _set_components.size();
+				bool is_destroyed = false;
+				bool is_created = false;
+				
+				for (; command_index < _command_order.size() && _command_order[command_index]->target == current_entity; ++command_index)
 				{
-					// execute commands in as few batches as possible
-					
-					if (_commands[command_index].type == entity_command_type::destroy_entity)
-					{
-						// ignore following commands, entity will be destroyed anyways
-						execute_command(_commands[command_index]);
-						command_index = same_entity_modifications_end - 1;
-						continue;
-					}
-					else if (_commands[command_index].type == entity_command_type::create_entity)
+					entity_command &command = *_command_order[command_index];
+					const type_id component_type = command.component_type.id;
+					switch (command.type)
 					{
-						// create entity and patch the used 'virtual' one
-						current_entity = _execution_world.create_entity();
-						
-						for (std::size_t i = command_index + 1; i < same_entity_modifications_end; ++i)
+						case entity_command_type::destroy_entity:
+							is_destroyed = true;
+							break;
+						case entity_command_type::create_entity:
+							is_created = true;
+							break;
+						case entity_command_type::add_component:
 						{
-							_commands[i].target = current_entity;
+							erase_recorded(_set_components, first_set, component_type);
+							auto removed = std::find(_removed_types.begin() + first_removed, _removed_types.end(), component_type);
+							if (removed != _removed_types.end())
+							{
+								_removed_types.erase(removed);
+							}
+							record_component(_added_components, first_added, {command.component_type, command.destructor, command.value()});
+							break;
 						}
-						
-						++command_index; // advance so we don't run this command again
-					}
-					
-					std::size_t batched_commands_index = command_index;
-					
-					for (; batched_commands_index <= same_entity_modifications_end; ++batched_commands_index)
-					{
-						auto &current_command = _commands[batched_commands_index];
-						switch (_commands[batched_commands_index].type)
+						case entity_command_type::remove_component:
 						{
-							case entity_command_type::add_component:
+							erase_recorded(_added_components, first_added, component_type);
+							erase_recorded(_set_components, first_set, component_type);
+							if (std::find(_removed_types.begin() + first_removed, _removed_types.end(), component_type) == _removed_types.end())
 							{
-								add_command_data *command_data = reinterpret_cast<add_command_data *>(current_command.command_args);
-								added_types.push_back(current_command.component_type);
-								added_destructors.push_back(command_data->destructor);
-								break;
+								_removed_types.push_back(component_type);
 							}
-							case entity_command_type::remove_component:
+							break;
+						}
+						case entity_command_type::set_component:
+						{
+							recorded_component set_value{command.component_type, command.destructor, command.value()};
+							// setting a component that gets added by this buffer only changes the added value
+							if (find_recorded(_added_components, first_added, component_type) != nullptr)
 							{
-								removed_types.push_back(current_command.component_type.id);
-								break;
+								record_component(_added_components, first_added, set_value);
 							}
-							default:
+							else
 							{
-								// command was not batchable
-								arch_assert_internal(false);
-								break;
+								record_component(_set_components, first_set, set_value);
 							}
+							break;
 						}
 					}
-					
-					_execution_world.modify_component_set(current_entity, {added_types}, {added_destructors}, {removed_types});
-					// set component data of added components
+				}
+				
+				// entities that died before the playback, for example through an earlier buffer, ignore their commands like destroyed ones
+				if (is_destroyed || (not is_created && not _execution_world.is_alive(current_entity)))
+				{
+					if (not is_virtual_entity(current_entity))
 					{
-						for (std::size_t i = command_index; i < batched_commands_index; ++i)
-						{
-							auto &current_command = _commands[i];
-							if (current_command.type == entity_command_type::add_component)
-							{
-								add_command_data *command_data = reinterpret_cast<add_command_data *>(current_command.command_args);
-								void *target_component = _execution_world.get_component(current_entity, current_command.component_type.id);
-								std::memcpy(target_component, command_data->component_data, current_command.component_type.size);
-							}
-						}
+						_execution_world.destroy_entity(current_entity);
 					}
-					
-					// execute commands that could not be batched
-					for (std::size_t i = batched_commands_index; i < same_entity_modifications_end; ++i)
+					discard_recorded(_added_components, first_added);
+					discard_recorded(_set_components, first_set);
+					_removed_types.resize(first_removed);
+					continue;
+				}
+				
+				const std::size_t source_archetype_index = is_created ? world::BASE_ARCHETYPE_INDEX
+				                                                      : _execution_world.get_info(current_entity).owning_archetype_index;
+				const archetype &source_archetype = _execution_world._archetypes[source_archetype_index];
+				
+				// adding a component the entity already has only overwrites its value
+				for (std::size_t i = first_added; i < _added_components.size();)
+				{
+					if (source_archetype.contains_type(_added_components[i].type.id))
 					{
-						if (not IsBatchable(_commands[i].type))
-						{
-							execute_command(_commands[i]);
-						}
+						_set_components.push_back(_added_components[i]);
+						_added_components.erase(_added_components.begin() + i);
+					}
+					else
+					{
+						++i;
+					}
+				}
+				// removing a component the entity does not have does nothing
+				for (std::size_t i = first_removed; i < _removed_types.size();)
+				{
+					if (source_archetype.contains_type(_removed_types[i]))
+					{
+						++i;
+					}
+					else
+					{
+						_removed_types.erase(_removed_types.begin() + i);
 					}
-					
-					// jump ahead the modifications of the next entity
-					command_index = same_entity_modifications_end;
-					
-					added_types.clear();
-					added_destructors.clear();
-					removed_types.clear();
 				}
+				
+				std::sort(_added_components.begin() + first_added, _added_components.end(), [](const recorded_component &lhs, const recorded_component &rhs)
+				{
+					return lhs.type.id < rhs.type.id;
+				});
+				std::sort(_removed_types.begin() + first_removed, _removed_types.end());
+				
+				_changes.push_back({current_entity, source_archetype_index, is_created,
+				                    first_added, _added_components.size() - first_added,
+				                    first_removed, _removed_types.size() - first_removed,
+				                    first_set, _set_components.size() - first_set});
+			}
+		}
+		
+		/// orders changes by their kind, their source archetype and their added and removed types
+		[[nodiscard]]
+		std::strong_ordering compare_changes(const entity_change &lhs, const entity_change &rhs) const
+		{
+			if (lhs.is_created != rhs.is_created)
+			{
+				return lhs.is_created <=> rhs.is_created;
+			}
+			if (lhs.source_archetype_index != rhs.source_archetype_index)
+			{
+				return lhs.source_archetype_index <=> rhs.source_archetype_index;
+			}
+			if (lhs.n_added != rhs.n_added)
+			{
+				return lhs.n_added <=> rhs.n_added;
+			}
+			if (lhs.n_removed != rhs.n_removed)
+			{
+				return lhs.n_removed <=> rhs.n_removed;
+			}
+			for (std::size_t i = 0; i < lhs.n_added; ++i)
+			{
+				const type_id lhs_type = _added_components[lhs.first_added + i].type.id;
+				const type_id rhs_type = _added_components[rhs.first_added + i].type.id;
+				if (lhs_type != rhs_type)
+				{
+					return lhs_type.value <=> rhs_type.value;
+				}
+			}
+			for (std::size_t i = 0; i < lhs.n_removed; ++i)
+			{
+				const type_id lhs_type = _removed_types[lhs.first_removed + i];
+				const type_id rhs_type = _removed_types[rhs.first_removed + i];
+				if (lhs_type != rhs_type)
+				{
+					return lhs_type.value <=> rhs_type.value;
+				}
+			}
+			return std::strong_ordering::equal;
+		}
+		
+		/// applies the changes [group_begin, group_end), which all have the same source archetype, added types and removed types
+		void apply_changes(std::size_t group_begin, std::size_t group_end)
+		{
+			const entity_change &group_change = _changes[group_begin];
+			const std::size_t n_entities = group_end - group_begin;
+			
+			std::size_t target_archetype_index = group_change.source_archetype_index;
+			if (group_change.n_added != 0 || group_change.n_removed != 0)
+			{
+				_group_added_types.clear();
+				_group_added_destructors.clear();
+				for (std::size_t i = 0; i < group_change.n_added; ++i)
+				{
+					_group_added_types.push_back(_added_components[group_change.first_added + i].type);
+					_group_added_destructors.push_back(_added_components[group_change.first_added + i].destructor);
+				}
+				target_archetype_index = _execution_world.get_or_create_archetype_index(group_change.source_archetype_index, _group_added_types,
+				                                                                        _group_added_destructors,
+				                                                                        std::span(_removed_types).subspan(group_change.first_removed,
+				                                                                                                          group_change.n_removed));
 			}
 			
-			_commands.clear();
+			if (group_change.is_created)
+			{
+				std::span<const entity> created = _execution_world.create_entities_in(target_archetype_index, n_entities);
+				for (std::size_t i = 0; i < n_entities; ++i)
+				{
+					_changes[group_begin + i].target = created[i];
+				}
+			}
+			else if (target_archetype_index != group_change.source_archetype_index)
+			{
+				_group_entities.clear();
+				for (std::size_t i = group_begin; i < group_end; ++i)
+				{
+					_group_entities.push_back(_changes[i].target);
+				}
+				_execution_world.move_entities_to(_group_entities, group_change.source_archetype_index,
+				                                  _execution_world.get_transition(group_change.source_archetype_index, target_archetype_index));
+			}
+			
+			// added components are still uninitialized, the recorded values get moved into them column by column
+			det::archetype_internal &target_archetype = _execution_world._archetypes[target_archetype_index].internal();
+			for (std::size_t added_index = 0; added_index < group_change.n_added; ++added_index)
+			{
+				const type_info added_type = _added_components[group_change.first_added + added_index].type;
+				const std::size_t column_index = target_archetype.column_index_of(added_type.id);
+				for (std::size_t i = group_begin; i < group_end; ++i)
+				{
+					const std::size_t in_archetype_index = _execution_world.get_info(_changes[i].target).in_archetype_index;
+					std::memcpy(target_archetype.get_column_data(in_archetype_index, column_index),
+					            _added_components[_changes[i].first_added + added_index].data, added_type.size);
+				}
+			}
+			
+			for (std::size_t i = group_begin; i < group_end; ++i)
+			{
+				const entity_change &change = _changes[i];
+				for (std::size_t set_index = change.first_set; set_index < change.first_set + change.n_set; ++set_index)
+				{
+					const recorded_component &set_value = _set_components[set_index];
+					void *component = _execution_world.get_component(change.target, set_value.type.id);
+					set_value.destructor.value(component, 1);
+					std::memcpy(component, set_value.data, set_value.type.size);
+				}
+			}
 		}
-	
-	private:
-		void optimize_entity_modification_order()
+		
+		[[nodiscard]]
+		static recorded_component *find_recorded(std::vector<recorded_component> &recorded, std::size_t first, type_id component_type)
 		{
-			std::stable_sort(_commands.begin(), _commands.end(), [](const entity_command &lhs, const entity_command &rhs)
+			for (std::size_t i = first; i < recorded.size(); ++i)
 			{
-				return lhs.target < rhs.target;
-			});
-			// we could also sort by an entity's archetype, but this probably does not gain us much in typical use cases as the commands usually happen inside
-			// world.foreach calls which in itself operate on a per-archetype basis
+				if (recorded[i].type.id == component_type)
+				{
+					return &recorded[i];
+				}
+			}
+			return nullptr;
+		}
+		
+		/// stores the value of a component, replacing and destroying a previously recorded value of the same type
+		static void record_component(std::vector<recorded_component> &recorded, std::size_t first, recorded_component value)
+		{
+			if (recorded_component *previous = find_recorded(recorded, first, value.type.id))
+			{
+				previous->destructor.value(previous->data, 1);
+				*previous = value;
+			}
+			else
+			{
+				recorded.push_back(value);
+			}
+		}
+		
+		/// destroys and forgets the recorded value of a component, if there is one
+		static void erase_recorded(std::vector<recorded_component> &recorded, std::size_t first, type_id component_type)
+		{
+			if (recorded_component *previous = find_recorded(recorded, first, component_type))
+			{
+				previous->destructor.value(previous->data, 1);
+				recorded.erase(recorded.begin() + (previous - recorded.data()));
+			}
+		}
+		
+		/// destroys and forgets all values recorded from first onwards
+		static void discard_recorded(std::vector<recorded_component> &recorded, std::size_t first)
+		{
+			for (std::size_t i = first; i < recorded.size(); ++i)
+			{
+				recorded[i].destructor.value(recorded[i].data, 1);
+			}
+			recorded.resize(first);
 		}
 		
 		[[nodiscard]]
@@ -307,7 +595,165 @@ namespace arch
 		/// counts how many entities this command buffer has created
 		entity_id_t n_created_entities = 0;
 		world &_execution_world;
-		std::pmr::vector<entity_command> _commands;
-		std::pmr::monotonic_buffer_resource _memory_buffer;
+		/// all recorded commands, each directly followed by its component value
+		det::byte_vector _command_stream;
+		/// the commands inside _command_stream in the order they get executed in, only filled while running
+		std::vector<entity_command *> _command_order{};
+		std::uint64_t _sort_key = 0;
+		bool _has_sort_key = false;
+		/// set for the buffers of a parallel_entity_command_buffer, which play back their commands ordered by sort key
+		bool _requires_sort_key = false;
+		
+		/// buffers used by run, kept to reuse their memory
+		std::vector<entity_change> _changes{};
+		std::vector<recorded_component> _added_components{};
+		std::vector<type_id> _removed_types{};
+		std::vector<recorded_component> _set_components{};
+		std::vector<type_info> _group_added_types{};
+		std::vector<det::multi_destructor> _group_added_destructors{};
+		std::vector<entity> _group_entities{};
+		
+		friend class parallel_entity_command_buffer;
+	};
+	
+	/// Command buffer that all threads of a thread_pool can record into at the same time without locking. Every thread records into its own
+	/// entity_command_buffer, run merges them ordered by the sort keys of the commands. As long as the sort keys identify the recorded work,
+	/// the result does not depend on which thread did the work. Every thread has to set a sort key before recording, see
+	/// entity_command_buffer::set_sort_key
+	class parallel_entity_command_buffer
+	{
+	public:
+		/// \param n_threads number of threads that record commands, by default the number of threads of the worlds thread pool
+		explicit parallel_entity_command_buffer(world &execution_world, std::size_t n_threads = 0, std::size_t buffer_size = 128)
+				: _merged(execution_world, 0)
+		{
+			if (n_threads == 0)
+			{
+				n_threads = execution_world.get_thread_pool().thread_count();
+			}
+			
+			_thread_buffers.reserve(n_threads);
+			for (std::size_t i = 0; i < n_threads; ++i)
+			{
+				_thread_buffers.push_back(std::make_unique<entity_command_buffer>(execution_world, buffer_size));
+				_thread_buffers.back()->_requires_sort_key = true;
+			}
+		}
+		
+		/// \return the buffer of the thread with the given index, see thread_pool::run
+		[[nodiscard]]
+		entity_command_buffer &for_thread(std::size_t thread_index)
+		{
+			arch_assert_external(thread_index < _thread_buffers.size());
+			return *_thread_buffers[thread_index];
+		}
+		
+		/// \return the buffer of the calling thread, for use inside functions running on a thread_pool like the ones of world::for_all_parallel
+		[[nodiscard]]
+		entity_command_buffer &local()
+		{
+			return for_thread(thread_pool::current_thread_index());
+		}
+		
+		/// merges the commands of all threads and executes them. May not be called while other threads are still recording
+		void run()
+		{
+			merge_thread_buffers();
+			_merged.play_back();
+			_merged.clear_commands();
+			
+			for (auto &thread_buffer: _thread_buffers)
+			{
+				thread_buffer->clear_commands();
+			}
+		}
+		
+		/// drops the commands of all threads without executing them, see entity_command_buffer::reset
+		void reset()
+		{
+			for (auto &thread_buffer: _thread_buffers)
+			{
+				thread_buffer->reset();
+			}
+		}
+	
+	private:
+		using entity_command = entity_command_buffer::entity_command;
+		
+		/// position of a command inside the buffer of its thread
+		struct command_reference
+		{
+			std::uint64_t sort_key;
+			std::uint32_t thread_index;
+			std::uint32_t command_index;
+		};
+		
+		void merge_thread_buffers()
+		{
+			_merge_order.clear();
+			for (std::size_t thread_index = 0; thread_index < _thread_buffers.size(); ++thread_index)
+			{
+				_thread_buffers[thread_index]->collect_commands();
+				const auto &commands = _thread_buffers[thread_index]->_command_order;
+				for (std::size_t command_index = 0; command_index < commands.size(); ++command_index)
+				{
+					_merge_order.push_back({commands[command_index]->sort_key, static_cast<std::uint32_t>(thread_index),
+					                        static_cast<std::uint32_t>(command_index)});
+				}
+			}
+			
+			// commands with the same key come from the same piece of work and thereby the same thread, so the command index keeps their order
+			std::sort(_merge_order.begin(), _merge_order.end(), [](const command_reference &lhs, const command_reference &rhs)
+			{
+				if (lhs.sort_key != rhs.sort_key)
+				{
+					return lhs.sort_key < rhs.sort_key;
+				}
+				if (lhs.thread_index != rhs.thread_index)
+				{
+					return lhs.thread_index < rhs.thread_index;
+				}
+				return lhs.command_index < rhs.command_index;
+			});
+			
+			// virtual entities of different threads share ids, renumber them in the order they first appear in
+			_virtual_entity_ids.resize(_thread_buffers.size());
+			for (std::size_t thread_index = 0; thread_index < _thread_buffers.size(); ++thread_index)
+			{
+				_virtual_entity_ids[thread_index].assign(_thread_buffers[thread_index]->n_created_entities, NO_VIRTUAL_ENTITY);
+			}
+			
+			entity_id_t n_created_entities = 0;
+			_merged._command_order.clear();
+			_merged._command_order.reserve(_merge_order.size());
+			for (const command_reference &reference: _merge_order)
+			{
+				// every command is referenced once, so it can be renumbered in place
+				entity_command *command = _thread_buffers[reference.thread_index]->_command_order[reference.command_index];
+				if (entity_command_buffer::is_target_virtual_entity(*command))
+				{
+					entity_id_t &merged_id = _virtual_entity_ids[reference.thread_index][command->target.id];
+					if (merged_id == NO_VIRTUAL_ENTITY)
+					{
+						merged_id = n_created_entities;
+						++n_created_entities;
+					}
+					command->target.id = merged_id;
+				}
+				_merged._command_order.push_back(command);
+			}
+			_merged.n_created_entities = n_created_entities;
+		}
+	
+	private:
+		static constexpr entity_id_t NO_VIRTUAL_ENTITY = std::numeric_limits<entity_id_t>::max();
+		
+		/// one buffer per thread, allocated separately so that threads do not write to the same cache lines
+		std::vector<std::unique_ptr<entity_command_buffer>> _thread_buffers{};
+		/// plays back the commands of all threads in their final order, the commands themselves stay inside the streams of the threads
+		entity_command_buffer _merged;
+		std::vector<command_reference> _merge_order{};
+		/// new id of every virtual entity, per thread
+		std::vector<std::vector<entity_id_t>> _virtual_entity_ids{};
 	};
 }
\ No newline at end of file
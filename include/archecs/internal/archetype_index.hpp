@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "helper_macros.hpp"
+#include "../type_id.hpp"
+
+namespace arch::det
+{
+	/// Maps sorted sets of types to the index of the archetype containing exactly these types. The 64 bit signatures of the sets are used
+	/// for a fast lookup, the full type sets are only compared once a signature matched
+	class archetype_index
+	{
+	public:
+		static constexpr std::size_t no_archetype = std::numeric_limits<std::size_t>::max();
+		
+		/// \param sorted_types in ascending order
+		/// \param archetypes all archetypes that were inserted into this index, needs to support archetypes[i].get_contained_types()
+		/// \return the index of the archetype that contains exactly sorted_types or no_archetype if there is none
+		template<typename t_archetypes>
+		[[nodiscard]]
+		std::size_t find(std::uint64_t signature, std::span<const type_id> sorted_types, const t_archetypes &archetypes) const
+		{
+			auto found = _first_with_signature.find(signature);
+			if (found == _first_with_signature.end())
+			{
+				return no_archetype;
+			}
+			
+			for (std::size_t candidate = found->second; candidate != no_archetype; candidate = _next_with_signature[candidate])
+			{
+				std::span<const type_id> candidate_types = archetypes[candidate].get_contained_types();
+				if (std::equal(candidate_types.begin(), candidate_types.end(), sorted_types.begin(), sorted_types.end()))
+				{
+					return candidate;
+				}
+			}
+			
+			return no_archetype;
+		}
+		
+		/// registers a new archetype. an archetype with the same types may not have been inserted before
+		void insert(std::uint64_t signature, std::size_t archetype_index)
+		{
+			if (_next_with_signature.size() <= archetype_index)
+			{
+				_next_with_signature.resize(archetype_index + 1, no_archetype);
+			}
+			
+			auto [found, inserted] = _first_with_signature.try_emplace(signature, archetype_index);
+			if (not inserted)
+			{
+				// signature collision, chain the archetypes
+				_next_with_signature[archetype_index] = found->second;
+				found->second = archetype_index;
+			}
+		}
+		
+		void clear()
+		{
+			_first_with_signature.clear();
+			_next_with_signature.clear();
+		}
+	
+	private:
+		std::unordered_map<std::uint64_t, std::size_t> _first_with_signature{};
+		/// for every archetype the next archetype with the same signature
+		std::vector<std::size_t> _next_with_signature{};
+	};
+}
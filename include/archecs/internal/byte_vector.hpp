@@ -7,6 +7,8 @@
 
 namespace arch::det
 {
+	/// size of a cache line on the targeted platforms. all byte_vector allocations are aligned to at least this value
+	inline constexpr std::size_t cache_line_size = 64;
 	
 	/// A vector implementation that only stores bytes
 	class byte_vector
@@ -19,8 +21,16 @@ namespace arch::det
 		{
 		}
 		
+		/// \param alignment the data of the vector gets aligned to. values below cache_line_size get raised to cache_line_size
+		constexpr byte_vector(std::pmr::memory_resource &resource, std::size_t alignment) noexcept
+				: _resource(&resource),
+				  _alignment(alignment < cache_line_size ? cache_line_size : alignment)
+		{
+		}
+		
 		byte_vector(byte_vector &&other) noexcept
 				: _resource(other._resource),
+				  _alignment(other._alignment),
 				  _data_begin(other._data_begin),
 				  _data_end(other._data_end),
 				  _capacity_end(other._capacity_end)
@@ -32,7 +42,8 @@ namespace arch::det
 		}
 		
 		byte_vector(const byte_vector &other) noexcept
-				: _resource(other._resource)
+				: _resource(other._resource),
+				  _alignment(other._alignment)
 		{
 			if (other._data_begin != nullptr)
 			{
@@ -47,7 +58,7 @@ namespace arch::det
 		{
 			if (_data_begin != nullptr)
 			{
-				_resource->deallocate(_data_begin, byte_capacity());
+				_resource->deallocate(_data_begin, byte_capacity(), _alignment);
 			}
 		}
 		
@@ -121,6 +132,21 @@ namespace arch::det
 			_data_end = _data_begin + target_size;
 		}
 		
+		/// makes sure that at least capacity bytes can be stored without allocating again
+		void reserve_bytes(std::size_t capacity)
+		{
+			if (byte_capacity() < capacity)
+			{
+				set_capacity(capacity);
+			}
+		}
+		
+		/// removes all contents but keeps the allocated memory
+		void clear() noexcept
+		{
+			_data_end = _data_begin;
+		}
+		
 		/// Reduces the size of the vector by size bytes
 		/// \param size
 		void pop_back_bytes(std::size_t size) noexcept
@@ -132,15 +158,26 @@ namespace arch::det
 		{
 			return _data_begin + offset;
 		}
+		
+		/// \return the alignment of the vectors data
+		[[nodiscard]]
+		std::size_t byte_alignment() const noexcept
+		{
+			return _alignment;
+		}
 	
 	protected:
 		void set_capacity(std::size_t target_capacity)
 		{
 			const auto previous_size = byte_size();
 			const auto next_capacity = target_capacity;
-			auto *next = reinterpret_cast<std::byte *>(_resource->allocate(next_capacity));
+			auto *next = reinterpret_cast<std::byte *>(_resource->allocate(next_capacity, _alignment));
 			
-			std::memcpy(next, _data_begin, previous_size);
+			if (_data_begin != nullptr)
+			{
+				std::memcpy(next, _data_begin, previous_size);
+				_resource->deallocate(_data_begin, byte_capacity(), _alignment);
+			}
 			_data_begin = next;
 			_data_end = next + previous_size;
 			_capacity_end = _data_begin + next_capacity;
@@ -169,6 +206,7 @@ namespace arch::det
 	
 	protected:
 		std::pmr::memory_resource *_resource{};
+		std::size_t _alignment = cache_line_size;
 		std::byte *_data_begin{};
 		/// end of the current elements. note that only the element before sizeEnd is valid
 		std::byte *_data_end{};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "constructor_vtable.hpp"
+#include "byte_vector.hpp"
+
+namespace arch::det
+{
+	/// number of bytes a single chunk of an archetype occupies, unless one row of the archetype does not fit into it
+	inline constexpr std::size_t default_chunk_size = 16 * 1024;
+	
+	/// minimum alignment of chunk memory and of every column inside a chunk. over-aligned component types raise the alignment of their column
+	inline constexpr std::size_t chunk_column_alignment = cache_line_size;
+	
+	[[nodiscard]]
+	constexpr std::size_t align_up(std::size_t value, std::size_t alignment) noexcept
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+	
+	[[nodiscard]]
+	constexpr std::size_t column_alignment_of(std::size_t type_alignment) noexcept
+	{
+		return type_alignment < chunk_column_alignment ? chunk_column_alignment : type_alignment;
+	}
+	
+	/// tick of the world at which a column of a chunk was last written to, used to skip unchanged chunks in queries
+	using change_tick = std::uint64_t;
+	
+	/// describes where the data of a single component type lives inside each chunk of an archetype
+	struct chunk_column
+	{
+		std::size_t element_size;
+		/// alignment of the column inside the chunk, at least chunk_column_alignment
+		std::size_t alignment;
+		multi_destructor destructor;
+		/// offset of the column relative to the beginning of a chunk, in bytes
+		std::size_t offset = 0;
+	};
+	
+	/// number of worlds sharing the memory of a chunk after world::fork. the last one releasing the chunk destroys and deallocates it
+	struct chunk_owners
+	{
+		std::atomic<std::size_t> count;
+	};
+	
+	/// A fixed size block of memory that contains the entity ids and all component columns of up to chunk_capacity entities.
+	/// The entity ids are always stored at the beginning of the block, followed by the columns
+	struct chunk
+	{
+		std::byte *data = nullptr;
+		/// number of entities stored in this chunk
+		std::size_t size = 0;
+		/// the memory is owned by someone else, for example a memory mapped snapshot, and must not be deallocated
+		bool borrowed = false;
+		/// set while the memory is shared with a fork, which makes it read only. nullptr if the chunk is the only owner
+		chunk_owners *owners = nullptr;
+		/// where the memory has to be returned to if it did not come from the chunk resource of the archetype, for example after world::merge_from
+		std::pmr::memory_resource *resource = nullptr;
+	};
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+#include "helper_macros.hpp"
+#include "../type_id.hpp"
+
+#if !defined ARCH_MAX_COMPONENT_TYPES
+#define ARCH_MAX_COMPONENT_TYPES 256
+#endif
+
+namespace arch::det
+{
+	/// maximum number of different component types a program can use, can be changed by defining ARCH_MAX_COMPONENT_TYPES
+	inline constexpr std::size_t max_component_types = ARCH_MAX_COMPONENT_TYPES;
+	
+	static_assert(max_component_types > 0 && max_component_types % 64 == 0, "ARCH_MAX_COMPONENT_TYPES needs to be a multiple of 64");
+	
+	/// Assigns every component type a small dense index, in the order the types are first seen. The indices are shared between all worlds
+	class component_registry
+	{
+	public:
+		/// Component masks only have room for max_component_types indices, so this throws std::length_error in every build configuration
+		/// once a program uses more types, instead of writing outside of the masks
+		[[nodiscard]]
+		static std::size_t index_of(type_id type)
+		{
+			component_registry &registry = instance();
+			std::lock_guard lock(registry._mutex);
+			
+			auto [found, inserted] = registry._indices.try_emplace(type, registry._indices.size());
+			if (found->second >= max_component_types)
+			{
+				registry._indices.erase(found);
+				throw std::length_error("more component types than ARCH_MAX_COMPONENT_TYPES are used");
+			}
+			return found->second;
+		}
+	
+	private:
+		[[nodiscard]]
+		static component_registry &instance()
+		{
+			static component_registry registry{};
+			return registry;
+		}
+		
+		std::mutex _mutex{};
+		std::unordered_map<type_id, std::size_t> _indices{};
+	};
+	
+	/// \return the dense index of T, only looked up inside the registry on first use
+	template<typename T>
+	[[nodiscard]]
+	std::size_t component_index_of()
+	{
+		static const std::size_t index = component_registry::index_of(id_of<T>());
+		return index;
+	}
+	
+	/// Fixed size bitset with one bit for every dense component index. All checks process the whole mask without early outs, so the compiler
+	/// can turn them into a few vector instructions
+	class component_mask
+	{
+	public:
+		static constexpr std::size_t bits_per_word = 64;
+		static constexpr std::size_t n_words = max_component_types / bits_per_word;
+		
+		template<typename ...t_components>
+		[[nodiscard]]
+		static component_mask of()
+		{
+			component_mask mask{};
+			(mask.set(component_index_of<t_components>()), ...);
+			return mask;
+		}
+		
+		[[nodiscard]]
+		static component_mask of(std::span<const type_id> types)
+		{
+			component_mask mask{};
+			for (type_id type: types)
+			{
+				mask.set(component_registry::index_of(type));
+			}
+			return mask;
+		}
+		
+		void set(std::size_t index)
+		{
+			arch_assert_internal(index < max_component_types);
+			_words[index / bits_per_word] |= std::uint64_t(1) << (index % bits_per_word);
+		}
+		
+		void reset(std::size_t index)
+		{
+			arch_assert_internal(index < max_component_types);
+			_words[index / bits_per_word] &= ~(std::uint64_t(1) << (index % bits_per_word));
+		}
+		
+		[[nodiscard]]
+		bool test(std::size_t index) const
+		{
+			arch_assert_internal(index < max_component_types);
+			return (_words[index / bits_per_word] >> (index % bits_per_word)) & 1;
+		}
+		
+		/// \return if every bit set in required is set in this mask as well
+		[[nodiscard]]
+		bool contains_all(const component_mask &required) const noexcept
+		{
+			std::uint64_t missing = 0;
+			for (std::size_t i = 0; i < n_words; ++i)
+			{
+				missing |= required._words[i] & ~_words[i];
+			}
+			return missing == 0;
+		}
+		
+		/// \return if at least one bit is set in both masks
+		[[nodiscard]]
+		bool intersects(const component_mask &other) const noexcept
+		{
+			std::uint64_t shared = 0;
+			for (std::size_t i = 0; i < n_words; ++i)
+			{
+				shared |= other._words[i] & _words[i];
+			}
+			return shared != 0;
+		}
+		
+		component_mask &operator|=(const component_mask &other) noexcept
+		{
+			for (std::size_t i = 0; i < n_words; ++i)
+			{
+				_words[i] |= other._words[i];
+			}
+			return *this;
+		}
+		
+		[[nodiscard]]
+		bool operator==(const component_mask &other) const noexcept
+		{
+			std::uint64_t different = 0;
+			for (std::size_t i = 0; i < n_words; ++i)
+			{
+				different |= other._words[i] ^ _words[i];
+			}
+			return different == 0;
+		}
+	
+	private:
+		std::array<std::uint64_t, n_words> _words{};
+	};
+	
+	/// \return the mask of all t_components, only built on first use
+	template<typename ...t_components>
+	[[nodiscard]]
+	const component_mask &mask_of()
+	{
+		static const component_mask mask = component_mask::of<t_components...>();
+		return mask;
+	}
+	
+	/// \return the mask of all t_components that are not pointers, only built on first use
+	template<typename ...t_components>
+	[[nodiscard]]
+	const component_mask &mask_of_non_pointers()
+	{
+		static const component_mask mask = []()
+		{
+			component_mask non_pointers{};
+			((std::is_pointer_v<t_components> ? void() : non_pointers.set(component_index_of<t_components>())), ...);
+			return non_pointers;
+		}();
+		return mask;
+	}
+}
@@ -1,8 +1,20 @@
 #pragma once
 
+#include <cstddef>
 #include <type_traits>
 #include <memory>
 
+namespace arch
+{
+	/// Decides if the column of a component type gets the functions copying its components, which world::instantiate, world::fork and
+	/// world::capture_state need. std::is_copy_constructible_v is true for types whose copy constructor does not compile, like structs holding
+	/// a std::vector<std::unique_ptr<int>>, so such components have to specialize this as std::false_type
+	template<typename T>
+	struct is_copyable_component : std::is_copy_constructible<T>
+	{
+	};
+}
+
 namespace arch::det
 {
 	template<typename T>
@@ -16,14 +28,39 @@ namespace arch::det
 		}
 	}
 	
+	/// copy constructs n elements at target from the single element at source
+	template<typename T>
+	static inline constexpr void copy_fill_n(void *target, const void *source, std::size_t n)
+	{
+		std::uninitialized_fill_n(reinterpret_cast<T *>(target), n, *reinterpret_cast<const T *>(source));
+	}
+	
+	/// copy constructs the n elements at target from the n elements at source
+	template<typename T>
+	static inline constexpr void copy_construct_n(void *target, const void *source, std::size_t n)
+	{
+		std::uninitialized_copy_n(reinterpret_cast<const T *>(source), n, reinterpret_cast<T *>(target));
+	}
+	
 	struct multi_destructor
 	{
 		void (*value)(void *, std::size_t);
+		/// nullptr for types that are not copyable, see is_copyable_component
+		void (*copy_fill)(void *, const void *, std::size_t) = nullptr;
+		/// nullptr for types that are not copyable, see is_copyable_component
+		void (*copy)(void *, const void *, std::size_t) = nullptr;
 	};
 	
 	template<typename T>
 	static constexpr multi_destructor multi_destructor_of()
 	{
-		return {&destruct_n<T>};
+		if constexpr (is_copyable_component<T>::value)
+		{
+			return {&destruct_n<T>, &copy_fill_n<T>, &copy_construct_n<T>};
+		}
+		else
+		{
+			return {&destruct_n<T>};
+		}
 	}
 }
\ No newline at end of file
@@ -33,7 +33,7 @@ namespace arch::det
 				std::destroy_at(current);
 			}
 			
-			_resource->deallocate(_data_begin, byte_capacity());
+			_resource->deallocate(_data_begin, byte_capacity(), _alignment);
 			
 			_data_end = _data_begin;
 			_capacity_end = _data_begin;
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <span>
+#include <type_traits>
 
 namespace arch::det
 {
@@ -47,4 +50,51 @@ namespace arch::det
 	
 	template<typename t>
 	using arguments_of = typename function_traits<decltype(&t::operator())>::arguments;
-}
\ No newline at end of file
+	
+	template<std::size_t index, typename t_list>
+	struct type_at_impl;
+	
+	template<std::size_t index, typename t_first, typename ...t_rest>
+	struct type_at_impl<index, type_list<t_first, t_rest...>>
+	{
+		using type = typename type_at_impl<index - 1, type_list<t_rest...>>::type;
+	};
+	
+	template<typename t_first, typename ...t_rest>
+	struct type_at_impl<0, type_list<t_first, t_rest...>>
+	{
+		using type = t_first;
+	};
+	
+	/// the index'th type of a type_list
+	template<std::size_t index, typename t_list>
+	using type_at = typename type_at_impl<index, t_list>::type;
+	
+	/// if a parameter of type t_argument can be used to write to the data it was passed
+	template<typename t_argument>
+	inline constexpr bool is_writable_argument = std::is_reference_v<t_argument> ? not std::is_const_v<std::remove_reference_t<t_argument>>
+	                                                                             : std::is_pointer_v<t_argument> && not std::is_const_v<std::remove_pointer_t<t_argument>>;
+	
+	template<typename t_element, std::size_t extent>
+	inline constexpr bool is_writable_argument<std::span<t_element, extent>> = not std::is_const_v<t_element>;
+	
+	template<typename t_element, std::size_t extent>
+	inline constexpr bool is_writable_argument<const std::span<t_element, extent>> = not std::is_const_v<t_element>;
+	
+	/// \return if t_function may write to the data passed as its argument_index'th argument. Functions with an overloaded or templated call
+	/// operator may write to all of their arguments
+	template<typename t_function, std::size_t argument_index>
+	consteval bool may_write_argument()
+	{
+		using function = std::remove_cvref_t<t_function>;
+		if constexpr (requires { &function::operator(); })
+		{
+			using arguments = arguments_of<function>;
+			if constexpr (argument_index < arguments::size())
+			{
+				return is_writable_argument<type_at<argument_index, arguments>>;
+			}
+		}
+		return true;
+	}
+}
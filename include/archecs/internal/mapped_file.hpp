@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <utility>
+
+#if defined __unix__ || defined __APPLE__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ARCH_HAS_MMAP 1
+#else
+#include <fstream>
+#include <new>
+#endif
+
+namespace arch::det
+{
+	/// Private, writable view of a whole file. Writes only change the memory, never the file. Uses mmap where it is available, so pages are only
+	/// read from disk once they get touched. Other platforms read the whole file into memory
+	class mapped_file
+	{
+	public:
+		/// alignment of data() if the file is not mapped
+		static constexpr std::size_t read_alignment = 4096;
+		
+		mapped_file() = default;
+		
+		mapped_file(mapped_file &&other) noexcept
+				: _data(std::exchange(other._data, nullptr)),
+				  _size(std::exchange(other._size, 0))
+		{}
+		
+		mapped_file &operator=(mapped_file &&other) noexcept
+		{
+			if (this != &other)
+			{
+				close();
+				_data = std::exchange(other._data, nullptr);
+				_size = std::exchange(other._size, 0);
+			}
+			return *this;
+		}
+		
+		~mapped_file()
+		{
+			close();
+		}
+		
+		/// \return false if the file could not be opened or is empty
+		bool open(const std::filesystem::path &path)
+		{
+			close();
+
+#if defined ARCH_HAS_MMAP
+			const int descriptor = ::open(path.c_str(), O_RDONLY);
+			if (descriptor < 0)
+			{
+				return false;
+			}
+			
+			struct stat file_status{};
+			if (::fstat(descriptor, &file_status) == 0 && file_status.st_size > 0)
+			{
+				const std::size_t size = static_cast<std::size_t>(file_status.st_size);
+				void *mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+				if (mapped != MAP_FAILED)
+				{
+					_data = static_cast<std::byte *>(mapped);
+					_size = size;
+				}
+			}
+			// the mapping stays valid without the descriptor
+			::close(descriptor);
+#else
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			const std::streamoff size = file ? static_cast<std::streamoff>(file.tellg()) : 0;
+			if (size > 0)
+			{
+				_data = static_cast<std::byte *>(::operator new(static_cast<std::size_t>(size), std::align_val_t(read_alignment)));
+				_size = static_cast<std::size_t>(size);
+				file.seekg(0);
+				if (not file.read(reinterpret_cast<char *>(_data), size))
+				{
+					close();
+				}
+			}
+#endif
+			return _data != nullptr;
+		}
+		
+		void close()
+		{
+			if (_data == nullptr)
+			{
+				return;
+			}
+
+#if defined ARCH_HAS_MMAP
+			::munmap(_data, _size);
+#else
+			::operator delete(_data, std::align_val_t(read_alignment));
+#endif
+			_data = nullptr;
+			_size = 0;
+		}
+		
+		[[nodiscard]]
+		std::byte *data() const noexcept
+		{
+			return _data;
+		}
+		
+		[[nodiscard]]
+		std::size_t size() const noexcept
+		{
+			return _size;
+		}
+	
+	private:
+		std::byte *_data = nullptr;
+		std::size_t _size = 0;
+	};
+}
@@ -3,10 +3,113 @@
 #include <vector>
 #include <unordered_map>
 #include <span>
+#include <mutex>
 #include "helper_macros.hpp"
+#include "../thread_pool.hpp"
 
 namespace arch::det
 {
+	template<typename t_job>
+	class scheduler;
+	
+	/// Jobs sorted into a valid execution order, together with the dependencies between them
+	template<typename t_job>
+	class job_graph
+	{
+	public:
+		struct job_node
+		{
+			t_job *job;
+			/// number of jobs that need to finish before this one may start
+			std::size_t previous_count = 0;
+			/// indices of the jobs waiting for this one
+			std::vector<std::size_t> following{};
+		};
+		
+		[[nodiscard]]
+		std::span<const job_node> nodes() const
+		{
+			return _nodes;
+		}
+		
+		/// Calls execute_job for every job on the threads of pool. A job gets started as soon as all jobs it depends on are finished,
+		/// independent jobs may run at the same time. Calls to pool.run inside a job use the threads that wait for a job to become ready
+		template<typename t_function>
+		void run(thread_pool &pool, t_function &&execute_job) const
+		{
+			if (_nodes.empty())
+			{
+				return;
+			}
+			
+			std::vector<std::size_t> remaining_previous(_nodes.size());
+			// every job gets appended exactly once when it becomes ready, so the order of execution is a queue without removal
+			std::vector<std::size_t> ready_jobs{};
+			ready_jobs.reserve(_nodes.size());
+			for (std::size_t i = 0; i < _nodes.size(); ++i)
+			{
+				remaining_previous[i] = _nodes[i].previous_count;
+				if (remaining_previous[i] == 0)
+				{
+					ready_jobs.push_back(i);
+				}
+			}
+			
+			std::mutex ready_mutex{};
+			std::size_t next_ready = 0;
+			std::size_t n_unfinished = _nodes.size();
+			
+			// one long running task per thread that keeps taking ready jobs until all are done. threads without a ready job help with the
+			// nested calls to pool.run of the running jobs
+			pool.run(pool.thread_count(), [&](std::size_t, std::size_t)
+			{
+				while (true)
+				{
+					pool.help_until([&]()
+					{
+						std::lock_guard lock(ready_mutex);
+						return next_ready < ready_jobs.size() || n_unfinished == 0;
+					});
+					
+					std::unique_lock lock(ready_mutex);
+					if (n_unfinished == 0)
+					{
+						return;
+					}
+					if (next_ready == ready_jobs.size())
+					{
+						// another thread took the job first
+						continue;
+					}
+					
+					const job_node &current = _nodes[ready_jobs[next_ready]];
+					++next_ready;
+					lock.unlock();
+					
+					execute_job(*current.job);
+					
+					lock.lock();
+					--n_unfinished;
+					for (std::size_t following_index: current.following)
+					{
+						remaining_previous[following_index] -= 1;
+						if (remaining_previous[following_index] == 0)
+						{
+							ready_jobs.push_back(following_index);
+						}
+					}
+					lock.unlock();
+					pool.notify_helpers();
+				}
+			});
+		}
+	
+	private:
+		std::vector<job_node> _nodes{};
+		
+		friend class scheduler<t_job>;
+	};
+	
 	template<typename t_job>
 	class scheduler
 	{
@@ -43,6 +146,21 @@ namespace arch::det
 		}
 		
 		std::vector<t_job *> schedule_jobs()
+		{
+			job_graph<t_job> graph = schedule_graph();
+			
+			std::vector<t_job *> resulting_order{};
+			resulting_order.reserve(graph.nodes().size());
+			for (const auto &node: graph.nodes())
+			{
+				resulting_order.push_back(node.job);
+			}
+			
+			return resulting_order;
+		}
+		
+		/// sorts the jobs like schedule_jobs, but keeps the dependencies between them so that independent jobs can run in parallel
+		job_graph<t_job> schedule_graph()
 		{
 			// set tmp_dep_count
 			for (job_node &node: _jobs)
@@ -51,9 +169,6 @@ namespace arch::det
 			}
 			
 			// implementation of kahn's algorithm
-			std::vector<t_job *> resulting_order{};
-			resulting_order.reserve(_jobs.size());
-			
 			// get nodes with no dependency
 			std::vector<job_node *> start_nodes{};
 			start_nodes.reserve(_jobs.size());
@@ -69,7 +184,6 @@ namespace arch::det
 			for (std::size_t i = 0; i < start_nodes.size(); ++i)
 			{
 				job_node *start_job = start_nodes[i];
-				resulting_order.push_back(start_job->job);
 				
 				for (std::size_t previous_job_id: start_job->previous)
 				{
@@ -84,7 +198,28 @@ namespace arch::det
 			
 			arch_assert_external("Dependencies contain at least one cycle" && start_nodes.size() == _jobs.size());
 			
-			return resulting_order;
+			// position of each job inside the resulting order
+			std::vector<std::size_t> order_of_job(_jobs.size());
+			for (std::size_t i = 0; i < start_nodes.size(); ++i)
+			{
+				order_of_job[start_nodes[i] - _jobs.data()] = i;
+			}
+			
+			job_graph<t_job> resulting_graph{};
+			resulting_graph._nodes.reserve(start_nodes.size());
+			for (job_node *node: start_nodes)
+			{
+				auto &graph_node = resulting_graph._nodes.emplace_back();
+				graph_node.job = node->job;
+				graph_node.previous_count = node->previous_count;
+				graph_node.following.reserve(node->previous.size());
+				for (std::size_t following_job_id: node->previous)
+				{
+					graph_node.following.push_back(order_of_job[following_job_id]);
+				}
+			}
+			
+			return resulting_graph;
 		}
 	
 	private:
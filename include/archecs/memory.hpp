@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
+#if defined __linux__
+#include <sys/mman.h>
+#define ARCH_HAS_HUGE_PAGES 1
+#endif
+
+#include "internal/helper_macros.hpp"
+
+namespace arch
+{
+	/// Memory resource backed by transparent huge pages where the platform supports them, which lowers the TLB pressure of iterating over large
+	/// worlds. Every allocation gets rounded up to whole huge pages, so it is meant as the upstream of a resource requesting large blocks, for
+	/// example a std::pmr::monotonic_buffer_resource with a large initial size. Other platforms fall back to aligned operator new. Thread safe
+	class huge_page_resource : public std::pmr::memory_resource
+	{
+	public:
+		/// size and alignment of a single huge page
+		static constexpr std::size_t page_size = 2 * 1024 * 1024;
+	
+	protected:
+		void *do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			arch_assert_external(alignment <= page_size);
+
+#if defined ARCH_HAS_HUGE_PAGES
+			// the kernel only uses huge pages for ranges aligned to them, so a larger range gets mapped and trimmed
+			const std::size_t size = rounded_size(bytes);
+			void *mapped = ::mmap(nullptr, size + page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mapped == MAP_FAILED)
+			{
+				throw std::bad_alloc();
+			}
+			
+			auto *mapped_begin = static_cast<std::byte *>(mapped);
+			const std::size_t head = (page_size - reinterpret_cast<std::uintptr_t>(mapped_begin) % page_size) % page_size;
+			if (head != 0)
+			{
+				::munmap(mapped_begin, head);
+			}
+			::munmap(mapped_begin + head + size, page_size - head);
+			
+			std::byte *allocated = mapped_begin + head;
+			::madvise(allocated, size, MADV_HUGEPAGE);
+			return allocated;
+#else
+			return ::operator new(rounded_size(bytes), std::align_val_t(page_size));
+#endif
+		}
+		
+		void do_deallocate(void *allocated, std::size_t bytes, std::size_t) override
+		{
+#if defined ARCH_HAS_HUGE_PAGES
+			::munmap(allocated, rounded_size(bytes));
+#else
+			::operator delete(allocated, std::align_val_t(page_size));
+#endif
+		}
+		
+		[[nodiscard]]
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+		{
+			// memory can be returned to any instance
+			return dynamic_cast<const huge_page_resource *>(&other) != nullptr;
+		}
+	
+	private:
+		[[nodiscard]]
+		static constexpr std::size_t rounded_size(std::size_t bytes) noexcept
+		{
+			return bytes == 0 ? page_size : (bytes + page_size - 1) / page_size * page_size;
+		}
+	};
+}
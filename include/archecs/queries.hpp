@@ -8,6 +8,7 @@
 #endif
 
 #include "internal/helpers.hpp"
+#include "internal/component_mask.hpp"
 #include "type_id.hpp"
 
 namespace arch
@@ -30,6 +31,16 @@ namespace arch
 		template<typename t_filter>
 		struct component_query : public base_component_query
 		{
+			/// components whose change ticks decide if a chunk matches, see changed_q
+			using changed_components = type_list<>;
+			
+			/// \param changed for every type of changed_components, if its column changed since the query last ran
+			/// \return if the entities of a chunk of a matching archetype get visited
+			static bool chunk_matches(std::span<const bool>)
+			{
+				return true;
+			}
+			
 			template<typename t_filter_b>
 			consteval auto operator&&(t_filter_b) const
 			{
@@ -54,11 +65,23 @@ namespace arch
 		struct and_q : public component_query<and_q<t_filter_a, t_filter_b>>
 		{
 			using resulting_components = combined_list<typename t_filter_a::resulting_components, typename t_filter_b::resulting_components>;
+			using changed_components = combined_list<typename t_filter_a::changed_components, typename t_filter_b::changed_components>;
 			
 			constexpr static bool filter(std::span<const type_id> type)
 			{
 				return t_filter_a::filter(type) && t_filter_b::filter(type);
 			}
+			
+			static bool matches(const component_mask &mask)
+			{
+				return t_filter_a::matches(mask) && t_filter_b::matches(mask);
+			}
+			
+			static bool chunk_matches(std::span<const bool> changed)
+			{
+				constexpr std::size_t n_changed_a = t_filter_a::changed_components::size();
+				return t_filter_a::chunk_matches(changed.first(n_changed_a)) && t_filter_b::chunk_matches(changed.subspan(n_changed_a));
+			}
 		};
 		
 		/* TODO: decide how to handle resulting_components (either A or B)?
@@ -77,12 +100,19 @@ namespace arch
 		template<typename t_filter>
 		struct not_q : public det::component_query<not_q<t_filter>>
 		{
+			static_assert(t_filter::changed_components::size() == 0, "changed filters can not be negated");
+			
 			using resulting_components = det::type_list<>;
 			
 			constexpr static bool filter(std::span<const type_id> types)
 			{
 				return !t_filter::filter(types);
 			}
+			
+			static bool matches(const component_mask &mask)
+			{
+				return !t_filter::matches(mask);
+			}
 		};
 	}
 	
@@ -116,6 +146,13 @@ namespace arch
 			auto to_search = ids_of<t_components...>();
 			return contains_ids(types, to_search);
 		}
+		
+		/// \param mask component mask of an archetype
+		/// \return if that mask has the bits of all t_components set
+		static bool matches(const det::component_mask &mask)
+		{
+			return mask.contains_all(det::mask_of<t_components...>());
+		}
 	};
 	
 	template<typename ...t_components>
@@ -132,6 +169,42 @@ namespace arch
 	template<typename ...t_components>
 	inline constexpr has_q<t_components...> has = has_q<t_components...>();
 	
+	/// Like {@code has}, but only visits the chunks in which at least one of [t_components...] was accessed mutably since the last query with
+	/// the same change_tracker ran. Chunks also count as changed when entities get added to them or moved inside them. What the query itself
+	/// writes does not count for its next run
+	/// \tparam t_components
+	template<typename ...t_components>
+	struct changed_q : public det::component_query<changed_q<t_components...>>
+	{
+		static_assert(((not std::is_pointer_v<t_components>) and ...));
+		
+		using resulting_components = det::type_list<>;
+		using changed_components = det::type_list<t_components...>;
+		
+		constexpr static bool filter(std::span<const type_id> types)
+		{
+			return with_q<t_components...>::filter(types);
+		}
+		
+		static bool matches(const det::component_mask &mask)
+		{
+			return with_q<t_components...>::matches(mask);
+		}
+		
+		static bool chunk_matches(std::span<const bool> changed)
+		{
+			bool any_changed = false;
+			for (bool column_changed: changed)
+			{
+				any_changed |= column_changed;
+			}
+			return any_changed;
+		}
+	};
+	
+	template<typename ...t_components>
+	inline constexpr changed_q<t_components...> changed = changed_q<t_components...>();
+	
 	
 	/// Filters for all entities that have at least [t_components...]
 	/// \tparam t_components
@@ -146,6 +219,11 @@ namespace arch
 		{
 			return true;
 		}
+		
+		static bool matches(const det::component_mask &)
+		{
+			return true;
+		}
 	};
 	
 	template<typename ...t_components>
@@ -190,6 +268,13 @@ namespace arch
 				}
 			}
 		}
+		
+		/// \param mask component mask of an archetype
+		/// \return if that mask has exactly the bits of t_components set
+		static bool matches(const det::component_mask &mask)
+		{
+			return mask == det::mask_of<t_components...>();
+		}
 	};
 	
 	template<typename ...t_components>
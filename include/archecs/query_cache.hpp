@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <span>
+
+#include "type_id.hpp"
+#include "archetype.hpp"
+#include "queries.hpp"
+#include "internal/helpers.hpp"
+
+namespace arch
+{
+	namespace det
+	{
+		/// searches the columns of the wanted types inside the archetype
+		/// \return the column indices sorted by type_id, no_column for optional types the archetype does not contain
+		template<typename ...t_components>
+		[[nodiscard]]
+		std::array<std::size_t, sizeof...(t_components)> get_column_indices(const archetype &current_archetype, type_list<t_components...>)
+		{
+			constexpr std::array wanted_types = ids_of<t_components...>();
+			std::array<std::size_t, sizeof...(t_components)> column_indices;
+			
+			auto archetype_types = current_archetype.get_contained_types();
+			std::size_t vectors_index = 0;
+			for (std::size_t wanted_types_index = 0; wanted_types_index < wanted_types.size(); ++wanted_types_index)
+			{
+				// search for next type
+				while (vectors_index < archetype_types.size() && archetype_types[vectors_index] < wanted_types[wanted_types_index])
+				{
+					++vectors_index;
+				}
+				
+				if (vectors_index == archetype_types.size() || archetype_types[vectors_index] != wanted_types[wanted_types_index])
+				{
+					// optional type was not found
+					column_indices[wanted_types_index] = archetype_internal::no_column;
+				}
+				else
+				{
+					column_indices[wanted_types_index] = vectors_index;
+					++vectors_index;
+				}
+			}
+			
+			return column_indices;
+		}
+		
+		/// Filter deduced from the parameters of a function: every non pointer parameter is required, pointers are optional
+		template<typename ...t_args>
+		struct arguments_q
+		{
+			using resulting_components = type_list<t_args...>;
+			using changed_components = type_list<>;
+			
+			constexpr static bool filter(std::span<const type_id> types)
+			{
+				constexpr std::array required_type_ids = ids_of_non_pointers<t_args...>();
+				return contains_ids(types, required_type_ids);
+			}
+			
+			static bool matches(const component_mask &mask)
+			{
+				return mask.contains_all(mask_of_non_pointers<t_args...>());
+			}
+			
+			static bool chunk_matches(std::span<const bool>)
+			{
+				return true;
+			}
+		};
+		
+		/// \return a new index on every call, shared between all worlds
+		[[nodiscard]]
+		inline std::size_t next_filter_slot()
+		{
+			static std::atomic<std::size_t> next_slot{0};
+			return next_slot.fetch_add(1, std::memory_order_relaxed);
+		}
+		
+		/// \return an index only t_filter uses. Unlike id_of it can not collide with the one of another filter type
+		template<typename t_filter>
+		[[nodiscard]]
+		std::size_t filter_slot_of()
+		{
+			static const std::size_t slot = next_filter_slot();
+			return slot;
+		}
+		
+		/// type erased part of a query_cache so that a world can store the caches of all its queries together
+		class query_cache_base
+		{
+		public:
+			virtual ~query_cache_base() = default;
+			
+			/// gets called by the world every time it creates a new archetype
+			virtual void on_archetype_created(const archetype &created, std::size_t archetype_index) = 0;
+		};
+	}
+	
+	/// Remembers when its owner last ran a query with changed filters, so that the query only visits the chunks changed since then. Every
+	/// consumer of changes owns its own tracker, for example as a member of a system, so consumers of the same filter all see every change.
+	/// A tracker may only be used with one world and by one query at a time
+	class change_tracker
+	{
+	public:
+		/// \return the first tick of the world after the query using this tracker last started, 0 if it never ran. Columns stamped with it or a
+		/// later tick changed since
+		[[nodiscard]]
+		det::change_tick last_run_tick() const noexcept
+		{
+			return _last_run_tick;
+		}
+	
+	private:
+		det::change_tick _last_run_tick = 0;
+		
+		friend class world;
+	};
+	
+	/// Remembers which archetypes of a world match t_filter together with the columns of the filters components inside them,
+	/// so that iterating the query does not need to test every archetype again. Instances are owned by the world and obtained through world::query
+	template<typename t_filter>
+	class query_cache final : public det::query_cache_base
+	{
+	public:
+		using components = typename t_filter::resulting_components;
+		using changed_components = typename t_filter::changed_components;
+		
+		struct matched_archetype
+		{
+			std::size_t archetype_index;
+			/// column of every component inside the archetype, sorted by type_id. no_column for optional components the archetype does not contain
+			std::array<std::size_t, components::size()> column_indices;
+			/// column of every component of changed_components, in the order of changed_components
+			std::array<std::size_t, changed_components::size()> changed_column_indices;
+		};
+		
+		explicit query_cache(std::span<const archetype> existing_archetypes)
+		{
+			for (std::size_t i = 0; i < existing_archetypes.size(); ++i)
+			{
+				on_archetype_created(existing_archetypes[i], i);
+			}
+		}
+		
+		void on_archetype_created(const archetype &created, std::size_t archetype_index) override
+		{
+			if (t_filter::matches(created.get_component_mask()))
+			{
+				_matched_archetypes.push_back({archetype_index, det::get_column_indices(created, components{}),
+				                               get_changed_column_indices(created, changed_components{})});
+			}
+		}
+		
+		/// \return all archetypes matching the filter, in the order they were created
+		[[nodiscard]]
+		std::span<const matched_archetype> matched_archetypes() const noexcept
+		{
+			return _matched_archetypes;
+		}
+	
+	private:
+		template<typename ...t_changed>
+		[[nodiscard]]
+		static std::array<std::size_t, sizeof...(t_changed)> get_changed_column_indices(const archetype &created, det::type_list<t_changed...>)
+		{
+			return {created.column_index_of(id_of<t_changed>())...};
+		}
+	
+	private:
+		std::vector<matched_archetype> _matched_archetypes{};
+	};
+}
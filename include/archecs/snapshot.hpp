@@ -0,0 +1,776 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "world.hpp"
+#include "internal/mapped_file.hpp"
+
+namespace arch
+{
+	/// Saves worlds into binary files and restores them. Every chunk of every archetype is written as a whole, in the same layout it has in
+	/// memory, followed by the entity index. Loading maps the file into memory and lets the archetypes use the chunk images directly, so no
+	/// entity gets touched and pages are only read once they are accessed.
+	/// Delta snapshots only contain the pages of the entity index and the chunk columns that changed since an earlier snapshot, found through
+	/// the change ticks of the world, and get applied on top of the state of that snapshot.
+	/// Only trivially copyable components are supported, and snapshots can only be loaded by programs with the same chunk layout
+	class world_snapshot
+	{
+	public:
+		static constexpr std::uint32_t format_version = 2;
+		
+		/// Writes all entities of source_world into a file at path. Every component type inside the world has to be one of t_components...
+		/// \return the tick of the snapshot, later changes can be written with write_delta. std::nullopt if the file could not be written or the
+		/// world contains an unknown component type
+		template<typename ...t_components>
+		static std::optional<det::change_tick> write(world &source_world, const std::filesystem::path &path)
+		{
+			static_assert((std::is_trivially_copyable_v<t_components> && ...), "snapshots can only contain trivially copyable components");
+			constexpr std::array known_types = {info_of<t_components>()...};
+			
+			// checked up front, so an existing file at path is left untouched
+			if (not contains_only_known_types(source_world, known_types))
+			{
+				return std::nullopt;
+			}
+			
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			if (not file)
+			{
+				return std::nullopt;
+			}
+			
+			output_stream output{file};
+			output.write_value(header_of(source_world, full_magic, 0));
+			output.write_bytes(source_world._entities.data(), source_world._entities.size() * sizeof(world::entity_info));
+			
+			std::vector<std::byte> image{};
+			for (const archetype &current: source_world._archetypes)
+			{
+				const det::archetype_internal &current_archetype = current.internal();
+				write_archetype_header(output, current_archetype);
+				
+				// chunk images start at an offset that keeps them aligned once the file is mapped
+				const std::size_t stride = chunk_stride(current_archetype.chunk_bytes(), current_archetype.chunk_alignment());
+				output.pad_to(current_archetype.chunk_alignment());
+				image.assign(stride, std::byte{0});
+				for (std::size_t chunk_index = 0; chunk_index < current_archetype.chunk_count(); ++chunk_index)
+				{
+					current_archetype.copy_chunk_image(chunk_index, image.data());
+					output.write_bytes(image.data(), stride);
+				}
+			}
+			
+			return finish_writing(source_world, file);
+		}
+		
+		/// Writes everything that changed inside source_world since the snapshot or delta with the tick base_tick was written: the pages of the
+		/// entity index that contain created, destroyed or moved entities and the columns of all chunks that were written to. The number of
+		/// entities of every changed chunk is stored as well, so removed entities and chunks are part of the delta
+		/// \return the tick of the delta, see write. std::nullopt as well if source_world was rolled back after base_tick, since the chunks
+		/// returned to an earlier state keep their change ticks
+		template<typename ...t_components>
+		static std::optional<det::change_tick> write_delta(world &source_world, const std::filesystem::path &path, det::change_tick base_tick)
+		{
+			static_assert((std::is_trivially_copyable_v<t_components> && ...), "snapshots can only contain trivially copyable components");
+			constexpr std::array known_types = {info_of<t_components>()...};
+			
+			if (base_tick < source_world._last_rollback_tick || not contains_only_known_types(source_world, known_types))
+			{
+				return std::nullopt;
+			}
+			
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			if (not file)
+			{
+				return std::nullopt;
+			}
+			
+			output_stream output{file};
+			output.write_value(header_of(source_world, delta_magic, base_tick));
+			
+			std::span<const det::change_tick> page_ticks = source_world._entity_page_ticks;
+			output.write_value<std::uint64_t>(std::count_if(page_ticks.begin(), page_ticks.end(), [base_tick](det::change_tick tick)
+			{
+				return tick > base_tick;
+			}));
+			for (std::size_t page_index = 0; page_index < page_ticks.size(); ++page_index)
+			{
+				if (page_ticks[page_index] > base_tick)
+				{
+					output.write_value<std::uint64_t>(page_index);
+					output.write_bytes(source_world._entities.data() + page_index * world::ENTITY_PAGE_SIZE,
+					                   page_size(source_world._entities.size(), page_index) * sizeof(world::entity_info));
+				}
+			}
+			
+			for (const archetype &current: source_world._archetypes)
+			{
+				const det::archetype_internal &current_archetype = current.internal();
+				write_archetype_header(output, current_archetype);
+				
+				std::uint64_t n_changed_chunks = 0;
+				for (std::size_t chunk_index = 0; chunk_index < current_archetype.chunk_count(); ++chunk_index)
+				{
+					n_changed_chunks += changed_since(current_archetype.chunk_change_ticks(chunk_index), base_tick);
+				}
+				output.write_value(n_changed_chunks);
+				
+				std::span<const det::chunk_column> columns = current_archetype.columns();
+				for (std::size_t chunk_index = 0; chunk_index < current_archetype.chunk_count(); ++chunk_index)
+				{
+					std::span<const det::change_tick> ticks = current_archetype.chunk_change_ticks(chunk_index);
+					if (not changed_since(ticks, base_tick))
+					{
+						continue;
+					}
+					
+					// the entity ids come first, in the same order as inside the chunk and its ticks
+					const det::chunk &current_chunk = current_archetype.chunks()[chunk_index];
+					output.write_value(chunk_record{chunk_index, current_chunk.size});
+					output.write_bytes(ticks.data(), ticks.size_bytes());
+					if (ticks.back() > base_tick)
+					{
+						output.write_bytes(current_chunk.data, current_chunk.size * sizeof(entity));
+					}
+					for (std::size_t column_index = 0; column_index < columns.size(); ++column_index)
+					{
+						if (ticks[column_index] > base_tick)
+						{
+							output.write_bytes(current_chunk.data + columns[column_index].offset, current_chunk.size * columns[column_index].element_size);
+						}
+					}
+				}
+			}
+			
+			return finish_writing(source_world, file);
+		}
+		
+		/// Restores the entities stored in the file at path into target_world, which may not contain any entities yet. Every component type
+		/// inside the snapshot has to be one of t_components... The memory of the file stays in use for the lifetime of target_world
+		/// \return false if the file could not be read, is no snapshot of this version and layout or contains an unknown component type.
+		/// target_world does not contain any entities in that case
+		template<typename ...t_components>
+		static bool load(world &target_world, const std::filesystem::path &path)
+		{
+			static_assert((std::is_trivially_copyable_v<t_components> && ...), "snapshots can only contain trivially copyable components");
+			
+			arch_assert_external(target_world._entities.empty());
+			
+			det::mapped_file mapped{};
+			if (not mapped.open(path))
+			{
+				return false;
+			}
+			
+			input_stream input{mapped.data(), mapped.size()};
+			file_header header{};
+			if (not read_header(input, header, full_magic))
+			{
+				return false;
+			}
+			
+			const std::byte *entity_infos = input.take(header.n_entities, sizeof(world::entity_info));
+			if (entity_infos == nullptr)
+			{
+				return false;
+			}
+			
+			// first find all chunks, so that nothing changes if the snapshot turns out to be broken
+			std::vector<std::size_t> archetype_indices(header.n_archetypes);
+			std::vector<adopted_chunk> adopted{};
+			std::vector<column_header> saved_columns{};
+			for (std::size_t saved_index = 0; saved_index < header.n_archetypes; ++saved_index)
+			{
+				archetype_header saved{};
+				if (not read_archetype<t_components...>(input, target_world, saved, saved_columns, archetype_indices[saved_index])
+				    || target_world._archetypes[archetype_indices[saved_index]].internal().size() != 0)
+				{
+					return false;
+				}
+				
+				const std::size_t stride = chunk_stride(saved.chunk_bytes, saved.chunk_alignment);
+				input.skip_to(saved.chunk_alignment);
+				std::byte *chunks = input.take(saved.n_chunks, stride);
+				// every chunk except the last one is full
+				const bool chunks_match_size = saved.n_entities <= saved.n_chunks * saved.chunk_capacity
+				                               && saved.n_entities + saved.chunk_capacity > saved.n_chunks * saved.chunk_capacity;
+				if (chunks == nullptr || not chunks_match_size || reinterpret_cast<std::uintptr_t>(chunks) % saved.chunk_alignment != 0)
+				{
+					return false;
+				}
+				
+				std::size_t n_remaining = saved.n_entities;
+				for (std::size_t chunk_index = 0; chunk_index < saved.n_chunks; ++chunk_index)
+				{
+					const std::size_t n_in_chunk = std::min<std::size_t>(n_remaining, saved.chunk_capacity);
+					adopted.push_back({archetype_indices[saved_index], chunks + chunk_index * stride, n_in_chunk});
+					n_remaining -= n_in_chunk;
+				}
+			}
+			
+			if (not valid_entity_infos(entity_infos, header.n_entities, archetype_indices.size()))
+			{
+				return false;
+			}
+			target_world._entities.resize(header.n_entities);
+			restore_entity_infos(target_world, 0, entity_infos, header.n_entities, archetype_indices);
+			
+			for (const adopted_chunk &current: adopted)
+			{
+				target_world._archetypes[current.archetype_index].internal().adopt_chunk(current.data, current.n_entities);
+			}
+			target_world._entity_page_ticks.assign(page_count(header.n_entities), header.change_tick);
+			finish_restoring(target_world, header);
+			target_world._mapped_snapshots.push_back(std::make_shared<det::mapped_file>(std::move(mapped)));
+			
+			return true;
+		}
+		
+		/// Applies the delta at path to target_world, which has to contain exactly the state of the snapshot or delta the new one is based on and
+		/// may not have changed since it was loaded or applied. Every component type inside the delta has to be one of t_components...
+		/// \return false if the file could not be read, is no delta of this version and layout, is based on another snapshot or contains an
+		/// unknown component type. target_world stays unchanged in that case, except for archetypes that might have been created
+		template<typename ...t_components>
+		static bool apply_delta(world &target_world, const std::filesystem::path &path)
+		{
+			static_assert((std::is_trivially_copyable_v<t_components> && ...), "snapshots can only contain trivially copyable components");
+			
+			det::mapped_file mapped{};
+			if (not mapped.open(path))
+			{
+				return false;
+			}
+			
+			input_stream input{mapped.data(), mapped.size()};
+			file_header header{};
+			std::uint64_t n_changed_pages = 0;
+			if (not read_header(input, header, delta_magic) || header.base_tick + 1 != target_world.get_change_tick()
+			    || header.n_entities < target_world._entities.size() || not input.read_value(n_changed_pages)
+			    || n_changed_pages > page_count(header.n_entities))
+			{
+				return false;
+			}
+			
+			// first check the whole delta, so that nothing changes if it turns out to be broken
+			std::vector<changed_page> changed_pages(n_changed_pages);
+			std::size_t n_added_pages_found = 0;
+			for (changed_page &page: changed_pages)
+			{
+				if (not input.read_value(page.index) || page.index >= page_count(header.n_entities))
+				{
+					return false;
+				}
+				page.infos = input.take(page_size(header.n_entities, page.index), sizeof(world::entity_info));
+				if (page.infos == nullptr)
+				{
+					return false;
+				}
+				// pages that were not complete yet gained entities as well
+				n_added_pages_found += page.index >= target_world._entities.size() / world::ENTITY_PAGE_SIZE;
+			}
+			if (header.n_entities != target_world._entities.size()
+			    && n_added_pages_found != page_count(header.n_entities) - target_world._entities.size() / world::ENTITY_PAGE_SIZE)
+			{
+				return false;
+			}
+			
+			std::vector<std::size_t> archetype_indices(header.n_archetypes);
+			std::vector<restored_archetype> restored_archetypes(header.n_archetypes);
+			std::vector<restored_chunk> restored_chunks{};
+			std::vector<column_header> saved_columns{};
+			std::vector<std::size_t> chunk_sizes{};
+			for (std::size_t saved_index = 0; saved_index < header.n_archetypes; ++saved_index)
+			{
+				archetype_header saved{};
+				std::uint64_t n_changed_chunks = 0;
+				if (not read_archetype<t_components...>(input, target_world, saved, saved_columns, archetype_indices[saved_index])
+				    || not input.read_value(n_changed_chunks) || n_changed_chunks > saved.n_chunks)
+				{
+					return false;
+				}
+				
+				// chunks that did not change keep their number of entities, new ones have to be part of the delta
+				const det::archetype_internal &target_archetype = target_world._archetypes[archetype_indices[saved_index]].internal();
+				const std::size_t n_kept_chunks = std::min<std::size_t>(saved.n_chunks, target_archetype.chunk_count());
+				chunk_sizes.assign(saved.n_chunks, 0);
+				for (std::size_t chunk_index = 0; chunk_index < n_kept_chunks; ++chunk_index)
+				{
+					chunk_sizes[chunk_index] = target_archetype.chunks()[chunk_index].size;
+				}
+				
+				restored_archetypes[saved_index] = {archetype_indices[saved_index], saved.n_chunks, restored_chunks.size(), n_changed_chunks};
+				for (std::uint64_t i = 0; i < n_changed_chunks; ++i)
+				{
+					restored_chunk &restored = restored_chunks.emplace_back();
+					if (not read_chunk(input, saved, saved_columns, header.base_tick, restored) || restored.record.chunk_index >= saved.n_chunks
+					    || (restored.record.chunk_index >= n_kept_chunks && not restored.complete))
+					{
+						return false;
+					}
+					chunk_sizes[restored.record.chunk_index] = restored.record.size;
+				}
+				
+				// every chunk except the last one is full
+				std::uint64_t n_entities = 0;
+				for (std::size_t chunk_index = 0; chunk_index < chunk_sizes.size(); ++chunk_index)
+				{
+					const bool is_last = chunk_index + 1 == chunk_sizes.size();
+					if (chunk_sizes[chunk_index] == 0 || (not is_last && chunk_sizes[chunk_index] != saved.chunk_capacity))
+					{
+						return false;
+					}
+					n_entities += chunk_sizes[chunk_index];
+				}
+				if (n_entities != saved.n_entities)
+				{
+					return false;
+				}
+			}
+			
+			for (const changed_page &page: changed_pages)
+			{
+				if (not valid_entity_infos(page.infos, page_size(header.n_entities, page.index), archetype_indices.size()))
+				{
+					return false;
+				}
+			}
+			
+			target_world._entities.resize(header.n_entities);
+			target_world._entity_page_ticks.resize(page_count(header.n_entities));
+			for (const changed_page &page: changed_pages)
+			{
+				restore_entity_infos(target_world, page.index * world::ENTITY_PAGE_SIZE, page.infos, page_size(header.n_entities, page.index),
+				                     archetype_indices);
+				target_world._entity_page_ticks[page.index] = header.change_tick;
+			}
+			
+			for (const restored_archetype &restored: restored_archetypes)
+			{
+				det::archetype_internal &target_archetype = target_world._archetypes[restored.archetype_index].internal();
+				target_archetype.set_chunk_count(restored.n_chunks);
+				for (std::size_t i = restored.first_chunk; i < restored.first_chunk + restored.n_changed_chunks; ++i)
+				{
+					restore_chunk(target_archetype, restored_chunks[i], header.base_tick);
+				}
+			}
+			finish_restoring(target_world, header);
+			
+			return true;
+		}
+	
+	private:
+		static constexpr char full_magic[8] = {'A', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+		static constexpr char delta_magic[8] = {'A', 'R', 'C', 'H', 'D', 'L', 'T', 'A'};
+		
+		struct file_header
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t entity_info_size;
+			/// tick of the snapshot a delta is based on, 0 for complete snapshots
+			std::uint64_t base_tick;
+			std::uint64_t change_tick;
+			std::uint64_t n_entities;
+			std::uint64_t first_dead_entity;
+			std::uint64_t n_archetypes;
+		};
+		
+		struct archetype_header
+		{
+			std::uint64_t n_types;
+			std::uint64_t n_entities;
+			std::uint64_t n_chunks;
+			std::uint64_t chunk_capacity;
+			std::uint64_t chunk_bytes;
+			std::uint64_t chunk_alignment;
+		};
+		
+		struct column_header
+		{
+			type_id::type_id_t type;
+			std::uint32_t padding;
+			std::uint64_t element_size;
+			std::uint64_t offset;
+		};
+		
+		/// precedes the change ticks and the changed parts of a chunk inside a delta
+		struct chunk_record
+		{
+			std::uint64_t chunk_index;
+			std::uint64_t size;
+		};
+		
+		struct adopted_chunk
+		{
+			std::size_t archetype_index;
+			std::byte *data;
+			std::size_t n_entities;
+		};
+		
+		struct changed_page
+		{
+			std::uint64_t index;
+			const std::byte *infos;
+		};
+		
+		/// a chunk inside a delta, pointing into the mapped file. the ticks and the data of the delta do not need to be aligned
+		struct restored_chunk
+		{
+			chunk_record record;
+			const std::byte *ticks;
+			/// the changed parts of the chunk, in the same order as inside write_delta
+			const std::byte *data;
+			/// if the entity ids and all columns changed
+			bool complete;
+		};
+		
+		/// the changed chunks of an archetype as a range of restored chunks
+		struct restored_archetype
+		{
+			std::size_t archetype_index;
+			std::size_t n_chunks;
+			std::size_t first_chunk;
+			std::size_t n_changed_chunks;
+		};
+		
+		/// writes into a file while keeping track of the offset, so that chunk images can be aligned
+		struct output_stream
+		{
+			std::ofstream &file;
+			std::size_t offset = 0;
+			
+			void write_bytes(const void *data, std::size_t n_bytes)
+			{
+				file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(n_bytes));
+				offset += n_bytes;
+			}
+			
+			template<typename T>
+			void write_value(const T &value)
+			{
+				write_bytes(&value, sizeof(T));
+			}
+			
+			void pad_to(std::size_t alignment)
+			{
+				static constexpr char zeros[64]{};
+				std::size_t n_padding = det::align_up(offset, alignment) - offset;
+				while (n_padding != 0)
+				{
+					const std::size_t n_written = std::min(n_padding, sizeof(zeros));
+					write_bytes(zeros, n_written);
+					n_padding -= n_written;
+				}
+			}
+		};
+		
+		/// reads from the mapped file, every read fails once it would leave the file
+		struct input_stream
+		{
+			std::byte *data;
+			std::size_t size;
+			std::size_t offset = 0;
+			
+			/// \return the next n_elements elements of element_size bytes each or nullptr if the file is too short
+			std::byte *take(std::uint64_t n_elements, std::size_t element_size = 1)
+			{
+				if (n_elements > (size - offset) / element_size)
+				{
+					return nullptr;
+				}
+				std::byte *taken = data + offset;
+				offset += n_elements * element_size;
+				return taken;
+			}
+			
+			template<typename T>
+			bool read_value(T &value)
+			{
+				const std::byte *source = take(sizeof(T));
+				if (source == nullptr)
+				{
+					return false;
+				}
+				std::memcpy(&value, source, sizeof(T));
+				return true;
+			}
+			
+			void skip_to(std::size_t alignment)
+			{
+				offset = std::min(det::align_up(offset, alignment), size);
+			}
+		};
+		
+		[[nodiscard]]
+		static file_header header_of(const world &source_world, const char (&magic)[8], det::change_tick base_tick)
+		{
+			file_header header{{}, format_version, sizeof(world::entity_info), base_tick, source_world.get_change_tick(), source_world._entities.size(),
+			                   source_world._first_dead_entity, source_world._archetypes.size()};
+			std::memcpy(header.magic, magic, sizeof(magic));
+			return header;
+		}
+		
+		/// advances the tick of source_world, so that all later changes end up in the next delta
+		/// \return the tick of the written snapshot
+		[[nodiscard]]
+		static std::optional<det::change_tick> finish_writing(world &source_world, std::ofstream &file)
+		{
+			file.flush();
+			if (not file)
+			{
+				return std::nullopt;
+			}
+			return source_world._change_tick++;
+		}
+		
+		[[nodiscard]]
+		static bool read_header(input_stream &input, file_header &header, const char (&magic)[8])
+		{
+			return input.read_value(header) && std::memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == format_version
+			       && header.entity_info_size == sizeof(world::entity_info) && header.n_entities < world::NO_DEAD_ENTITY
+			       && header.n_archetypes <= input.size / sizeof(archetype_header);
+		}
+		
+		/// \return if every component type inside source_world is one of known_types
+		template<std::size_t n_known_types>
+		static bool contains_only_known_types(const world &source_world, const std::array<type_info, n_known_types> &known_types)
+		{
+			return std::all_of(source_world._archetypes.begin(), source_world._archetypes.end(), [&known_types](const archetype &current)
+			{
+				std::span<const type_id> types = current.internal().get_contained_types();
+				return std::all_of(types.begin(), types.end(), [&known_types](type_id type)
+				{
+					return std::find_if(known_types.begin(), known_types.end(), [type](const type_info &known)
+					{
+						return known.id == type;
+					}) != known_types.end();
+				});
+			});
+		}
+		
+		/// writes the types and the chunk layout of an archetype
+		static void write_archetype_header(output_stream &output, const det::archetype_internal &written)
+		{
+			std::span<const type_id> types = written.get_contained_types();
+			std::span<const det::chunk_column> columns = written.columns();
+			output.write_value(archetype_header{types.size(), written.size(), written.chunk_count(), written.chunk_capacity(), written.chunk_bytes(),
+			                                    written.chunk_alignment()});
+			for (std::size_t i = 0; i < types.size(); ++i)
+			{
+				output.write_value(column_header{types[i].value, 0, columns[i].element_size, columns[i].offset});
+			}
+		}
+		
+		/// reads the header and the columns of an archetype and finds or creates the archetype with the same types inside target_world
+		/// \return false if the archetype contains unknown types or its chunks look different than the ones inside target_world
+		template<typename ...t_components>
+		static bool read_archetype(input_stream &input, world &target_world, archetype_header &saved, std::vector<column_header> &saved_columns,
+		                           std::size_t &archetype_index)
+		{
+			constexpr std::array known_types = {info_of<t_components>()...};
+			constexpr std::array known_destructors = {det::multi_destructor_of<t_components>()...};
+			
+			if (not input.read_value(saved) || saved.n_types > det::max_component_types)
+			{
+				return false;
+			}
+			
+			std::array<type_info, det::max_component_types> types{};
+			std::array<det::multi_destructor, det::max_component_types> destructors{};
+			saved_columns.resize(saved.n_types);
+			for (std::size_t i = 0; i < saved.n_types; ++i)
+			{
+				column_header &column = saved_columns[i];
+				if (not input.read_value(column))
+				{
+					return false;
+				}
+				
+				auto found = std::find_if(known_types.begin(), known_types.end(), [&column](const type_info &known)
+				{
+					return known.id.value == column.type;
+				});
+				if (found == known_types.end() || found->size != column.element_size)
+				{
+					return false;
+				}
+				types[i] = *found;
+				destructors[i] = known_destructors[found - known_types.begin()];
+			}
+			
+			archetype_index = target_world.get_or_create_archetype_index(world::BASE_ARCHETYPE_INDEX, {types.data(), saved.n_types},
+			                                                             {destructors.data(), saved.n_types}, {});
+			return has_layout(target_world._archetypes[archetype_index].internal(), saved, saved_columns);
+		}
+		
+		/// \return if the chunks of target_archetype look exactly like the ones described by saved
+		[[nodiscard]]
+		static bool has_layout(const det::archetype_internal &target_archetype, const archetype_header &saved,
+		                       std::span<const column_header> saved_columns)
+		{
+			std::span<const det::chunk_column> columns = target_archetype.columns();
+			if (target_archetype.chunk_capacity() != saved.chunk_capacity || target_archetype.chunk_bytes() != saved.chunk_bytes
+			    || target_archetype.chunk_alignment() != saved.chunk_alignment || columns.size() != saved_columns.size())
+			{
+				return false;
+			}
+			
+			for (std::size_t i = 0; i < columns.size(); ++i)
+			{
+				if (columns[i].offset != saved_columns[i].offset || columns[i].element_size != saved_columns[i].element_size)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		
+		/// reads a chunk of a delta and checks that the file contains all of its changed parts
+		[[nodiscard]]
+		static bool read_chunk(input_stream &input, const archetype_header &saved, std::span<const column_header> saved_columns,
+		                       det::change_tick base_tick, restored_chunk &restored)
+		{
+			if (not input.read_value(restored.record) || restored.record.size > saved.chunk_capacity)
+			{
+				return false;
+			}
+			
+			restored.ticks = input.take(saved_columns.size() + 1, sizeof(det::change_tick));
+			if (restored.ticks == nullptr)
+			{
+				return false;
+			}
+			
+			std::size_t n_bytes = tick_at(restored.ticks, saved_columns.size()) > base_tick ? restored.record.size * sizeof(entity) : 0;
+			restored.complete = n_bytes != 0;
+			for (std::size_t column_index = 0; column_index < saved_columns.size(); ++column_index)
+			{
+				if (tick_at(restored.ticks, column_index) > base_tick)
+				{
+					n_bytes += restored.record.size * saved_columns[column_index].element_size;
+				}
+				else
+				{
+					restored.complete = false;
+				}
+			}
+			restored.data = input.take(n_bytes);
+			return restored.data != nullptr;
+		}
+		
+		/// copies the changed parts of a chunk inside a delta into the chunk of target_archetype
+		static void restore_chunk(det::archetype_internal &target_archetype, const restored_chunk &restored, det::change_tick base_tick)
+		{
+			const std::size_t chunk_index = restored.record.chunk_index;
+			// also gives the chunk its own memory if it is shared with a fork
+			target_archetype.set_chunk_size(chunk_index, restored.record.size);
+			std::byte *chunk_data = target_archetype.chunks()[chunk_index].data;
+			std::span<const det::chunk_column> columns = target_archetype.columns();
+			std::span<det::change_tick> ticks = target_archetype.chunk_change_ticks(chunk_index);
+			
+			const std::byte *source = restored.data;
+			if (tick_at(restored.ticks, columns.size()) > base_tick)
+			{
+				std::memcpy(chunk_data, source, restored.record.size * sizeof(entity));
+				source += restored.record.size * sizeof(entity);
+			}
+			for (std::size_t column_index = 0; column_index < columns.size(); ++column_index)
+			{
+				if (tick_at(restored.ticks, column_index) > base_tick)
+				{
+					const std::size_t n_bytes = restored.record.size * columns[column_index].element_size;
+					std::memcpy(chunk_data + columns[column_index].offset, source, n_bytes);
+					source += n_bytes;
+				}
+			}
+			std::memcpy(ticks.data(), restored.ticks, ticks.size_bytes());
+		}
+		
+		/// \return if every one of the n_infos entity_infos at infos is dead or refers to one of n_archetypes archetypes
+		[[nodiscard]]
+		static bool valid_entity_infos(const std::byte *infos, std::size_t n_infos, std::size_t n_archetypes)
+		{
+			for (std::size_t i = 0; i < n_infos; ++i)
+			{
+				world::entity_info info{};
+				std::memcpy(&info, infos + i * sizeof(world::entity_info), sizeof(world::entity_info));
+				if (info.owning_archetype_index != world::DEAD_ARCHETYPE_INDEX && info.owning_archetype_index >= n_archetypes)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		
+		/// copies n_infos entity_infos into the entity index of target_world, starting at first_id. the saved archetypes can end up at other indices
+		static void restore_entity_infos(world &target_world, std::size_t first_id, const std::byte *infos, std::size_t n_infos,
+		                                 std::span<const std::size_t> archetype_indices)
+		{
+			std::memcpy(target_world._entities.data() + first_id, infos, n_infos * sizeof(world::entity_info));
+			for (std::size_t id = first_id; id < first_id + n_infos; ++id)
+			{
+				world::entity_info &info = target_world._entities[id];
+				if (info.owning_archetype_index != world::DEAD_ARCHETYPE_INDEX)
+				{
+					info.owning_archetype_index = static_cast<std::uint32_t>(archetype_indices[info.owning_archetype_index]);
+				}
+			}
+		}
+		
+		static void finish_restoring(world &target_world, const file_header &header)
+		{
+			target_world._first_dead_entity = static_cast<entity_id_t>(header.first_dead_entity);
+			// ticks stored inside the chunks stay older than all later changes, which lets deltas check that they are based on this state
+			target_world._change_tick = std::max(target_world.get_change_tick(), header.change_tick + 1);
+		}
+		
+		/// \return if a column or the entity ids of a chunk changed after base_tick
+		[[nodiscard]]
+		static bool changed_since(std::span<const det::change_tick> ticks, det::change_tick base_tick)
+		{
+			return std::any_of(ticks.begin(), ticks.end(), [base_tick](det::change_tick tick)
+			{
+				return tick > base_tick;
+			});
+		}
+		
+		[[nodiscard]]
+		static det::change_tick tick_at(const std::byte *ticks, std::size_t index)
+		{
+			det::change_tick tick{};
+			std::memcpy(&tick, ticks + index * sizeof(det::change_tick), sizeof(det::change_tick));
+			return tick;
+		}
+		
+		/// distance between two chunk images inside a snapshot
+		[[nodiscard]]
+		static constexpr std::size_t chunk_stride(std::size_t chunk_bytes, std::size_t chunk_alignment) noexcept
+		{
+			return det::align_up(chunk_bytes, chunk_alignment);
+		}
+		
+		[[nodiscard]]
+		static constexpr std::size_t page_count(std::size_t n_entities) noexcept
+		{
+			return (n_entities + world::ENTITY_PAGE_SIZE - 1) / world::ENTITY_PAGE_SIZE;
+		}
+		
+		/// \return the number of entity_infos inside the page with the given index
+		[[nodiscard]]
+		static constexpr std::size_t page_size(std::size_t n_entities, std::size_t page_index) noexcept
+		{
+			return std::min(world::ENTITY_PAGE_SIZE, n_entities - page_index * world::ENTITY_PAGE_SIZE);
+		}
+	};
+}
@@ -2,6 +2,11 @@
 
 #include <string_view>
 #include <span>
+#include <type_traits>
+
+#include "entity.hpp"
+#include "internal/component_mask.hpp"
+#include "internal/helpers.hpp"
 
 namespace arch
 {
@@ -9,6 +14,120 @@ namespace arch
 	
 	class world;
 	
+	/// Components a system reads and writes. Systems whose accesses do not conflict are not ordered implicitly and may run at the same time.
+	/// Systems that did not declare their access conflict with every other system. A declared system may only run queries, and write the
+	/// components it declared, since other systems use the world at the same time
+	class component_access
+	{
+	public:
+		/// \return the access of a system that does not use any components
+		[[nodiscard]]
+		static component_access none()
+		{
+			component_access access{};
+			access._is_declared = true;
+			return access;
+		}
+		
+		/// Deduces the access from a list of types like the parameters of a for_all function: const types are read, all others written.
+		/// References, pointers and arch::entity are ignored
+		template<typename ...t_components>
+		[[nodiscard]]
+		static component_access of()
+		{
+			component_access access = none();
+			(access.add_parameter<t_components>(), ...);
+			return access;
+		}
+		
+		/// Like of, but also reads the components of the changed filters in filter, since checking if a column changed reads its change ticks
+		/// which writers of the component stamp
+		template<typename ...t_components, typename t_filter>
+		[[nodiscard]]
+		static component_access of(t_filter)
+		{
+			component_access access = of<t_components...>();
+			access.add_changed_reads(typename t_filter::changed_components{});
+			return access;
+		}
+		
+		template<typename ...t_components>
+		component_access &reads()
+		{
+			_is_declared = true;
+			_reads |= det::mask_of<t_components...>();
+			return *this;
+		}
+		
+		template<typename ...t_components>
+		component_access &writes()
+		{
+			_is_declared = true;
+			_writes |= det::mask_of<t_components...>();
+			return *this;
+		}
+		
+		/// \return if both systems may not run at the same time, because at least one of them writes a component the other one uses
+		[[nodiscard]]
+		bool conflicts_with(const component_access &other) const
+		{
+			if (not _is_declared || not other._is_declared)
+			{
+				return true;
+			}
+			
+			return _writes.intersects(other._writes) || _writes.intersects(other._reads) || _reads.intersects(other._writes);
+		}
+		
+		[[nodiscard]]
+		bool is_declared() const
+		{
+			return _is_declared;
+		}
+		
+		[[nodiscard]]
+		const det::component_mask &get_reads() const
+		{
+			return _reads;
+		}
+		
+		[[nodiscard]]
+		const det::component_mask &get_writes() const
+		{
+			return _writes;
+		}
+	
+	private:
+		template<typename t_parameter>
+		void add_parameter()
+		{
+			using component = std::remove_pointer_t<std::remove_reference_t<t_parameter>>;
+			if constexpr (std::is_same_v<std::remove_cv_t<component>, entity>)
+			{
+				return;
+			}
+			else if constexpr (std::is_const_v<component>)
+			{
+				reads<component>();
+			}
+			else
+			{
+				writes<component>();
+			}
+		}
+	
+		template<typename ...t_changed>
+		void add_changed_reads(det::type_list<t_changed...>)
+		{
+			reads<t_changed...>();
+		}
+	
+	private:
+		det::component_mask _reads{};
+		det::component_mask _writes{};
+		bool _is_declared = false;
+	};
+	
 	class system_base
 	{
 	public:
@@ -30,6 +149,11 @@ namespace arch
 		{
 			return system_name;
 		}
+		
+		const component_access &get_component_access() const
+		{
+			return accessed_components;
+		}
 	
 	protected:
 		update_group *get_group()
@@ -44,6 +168,8 @@ namespace arch
 	
 	protected:
 		std::string_view system_name{};
+		/// used to order systems that use the same components, systems without conflicts may run in parallel
+		component_access accessed_components{};
 	
 	private:
 		update_group *owning_group{};
@@ -0,0 +1,384 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <type_traits>
+#include <memory>
+#include <utility>
+
+#include "internal/helper_macros.hpp"
+
+namespace arch
+{
+	/// A fixed set of worker threads that stay parked between jobs, so that running work in parallel does not need to create threads.
+	/// The tasks of a job are split into one contiguous range per thread. Threads that run out of tasks steal half of the remaining range of
+	/// another thread, so uneven tasks get balanced without a shared queue.
+	/// Only one job runs at a time, calls to run from multiple threads are executed one after another. Calls to run from inside a task of the
+	/// same pool share their tasks with the threads of the outer job that wait inside help_until, and work on them on the calling thread as well
+	class thread_pool
+	{
+	public:
+		/// \return one worker for every hardware thread except the one calling run
+		[[nodiscard]]
+		static std::size_t default_worker_count()
+		{
+			const std::size_t hardware_threads = std::thread::hardware_concurrency();
+			return hardware_threads > 1 ? hardware_threads - 1 : 0;
+		}
+		
+		/// \param n_workers number of threads that get started in addition to the thread calling run
+		explicit thread_pool(std::size_t n_workers = default_worker_count())
+				: _task_ranges(std::make_unique<task_range[]>(n_workers + 1))
+		{
+			_workers.reserve(n_workers);
+			for (std::size_t i = 0; i < n_workers; ++i)
+			{
+				// index 0 belongs to the thread calling run
+				_workers.emplace_back([this, thread_index = i + 1]()
+				                      {
+					                      worker_loop(thread_index);
+				                      });
+			}
+		}
+		
+		thread_pool(const thread_pool &) = delete;
+		thread_pool &operator=(const thread_pool &) = delete;
+		
+		~thread_pool()
+		{
+			{
+				std::lock_guard lock(_mutex);
+				_stop = true;
+			}
+			_wake_workers.notify_all();
+			
+			for (std::thread &worker: _workers)
+			{
+				worker.join();
+			}
+		}
+		
+		/// \return number of threads taking part in a job, including the one calling run
+		[[nodiscard]]
+		std::size_t thread_count() const noexcept
+		{
+			return _workers.size() + 1;
+		}
+		
+		/// \return the thread_index the calling thread uses in the job it currently works on, 0 if it is not working on a job
+		[[nodiscard]]
+		static std::size_t current_thread_index() noexcept
+		{
+			return _executing_thread_index;
+		}
+		
+		/// Calls function(task_index, thread_index) for every task_index in [0, n_tasks) and blocks until all of them are done.
+		/// The calling thread works on tasks as well and always has the thread_index 0, workers use [1, thread_count()).
+		/// Nested calls keep the thread_index of the outer job, every thread helping with them uses its own one
+		template<typename t_function>
+		void run(std::size_t n_tasks, t_function &&function)
+		{
+			if (n_tasks == 0)
+			{
+				return;
+			}
+			
+			if (_workers.empty() || n_tasks == 1)
+			{
+				const std::size_t thread_index = _executing_pool == this ? _executing_thread_index : 0;
+				for (std::size_t task_index = 0; task_index < n_tasks; ++task_index)
+				{
+					function(task_index, thread_index);
+				}
+				return;
+			}
+			
+			if (_executing_pool == this)
+			{
+				run_nested(n_tasks, function);
+				return;
+			}
+			
+			arch_assert_external(n_tasks <= std::numeric_limits<std::uint32_t>::max());
+			
+			std::lock_guard run_lock(_run_mutex);
+			{
+				std::unique_lock lock(_mutex);
+				// workers that woke up late for the previous job may still be looking at it
+				_workers_done.wait(lock, [this]()
+				{
+					return _n_busy_workers == 0;
+				});
+				
+				_job = const_cast<void *>(static_cast<const void *>(std::addressof(function)));
+				_invoke_job = [](void *job, std::size_t task_index, std::size_t thread_index)
+				{
+					(*static_cast<std::remove_reference_t<t_function> *>(job))(task_index, thread_index);
+				};
+				// every thread starts with an equally sized range of tasks
+				const std::size_t n_threads = thread_count();
+				for (std::size_t thread_index = 0; thread_index < n_threads; ++thread_index)
+				{
+					_task_ranges[thread_index].bounds.store(pack_range(n_tasks * thread_index / n_threads, n_tasks * (thread_index + 1) / n_threads),
+					                                        std::memory_order_relaxed);
+				}
+				_n_unfinished_tasks.store(n_tasks, std::memory_order_relaxed);
+				++_generation;
+			}
+			_wake_workers.notify_all();
+			
+			work_on_tasks(0);
+			
+			std::unique_lock lock(_mutex);
+			_workers_done.wait(lock, [this]()
+			{
+				return _n_unfinished_tasks.load(std::memory_order_acquire) == 0 && _n_busy_workers == 0;
+			});
+		}
+		
+		/// Blocks a thread working on a task of this pool until done() returns true, and lets it work on the tasks of nested calls to run in the
+		/// meantime, so that a task waiting for others does not leave its thread idle.
+		/// done gets called with a lock of the pool held, whoever changes its result has to call notify_helpers afterwards
+		template<typename t_predicate>
+		void help_until(t_predicate &&done)
+		{
+			std::unique_lock lock(_nested_mutex);
+			while (not done())
+			{
+				auto open_job = std::find_if(_nested_jobs.begin(), _nested_jobs.end(), [](const nested_job *job)
+				{
+					return job->next_task.load(std::memory_order_relaxed) < job->n_tasks;
+				});
+				if (open_job == _nested_jobs.end())
+				{
+					_nested_changed.wait(lock);
+					continue;
+				}
+				
+				// the job stays alive until all of its helpers are gone
+				nested_job &helped_job = **open_job;
+				++helped_job.n_helpers;
+				lock.unlock();
+				
+				work_on_nested_job(helped_job, _executing_thread_index);
+				
+				lock.lock();
+				--helped_job.n_helpers;
+				if (helped_job.n_helpers == 0)
+				{
+					_nested_changed.notify_all();
+				}
+			}
+		}
+		
+		/// wakes up the threads inside help_until, so that they check their condition again
+		void notify_helpers()
+		{
+			{
+				// waiting threads either see the change while checking their condition or get woken up afterwards
+				std::lock_guard lock(_nested_mutex);
+			}
+			_nested_changed.notify_all();
+		}
+	
+	private:
+		/// tasks of a call to run from inside a task of this pool, taken one at a time by the calling thread and the threads inside help_until
+		struct nested_job
+		{
+			void *function;
+			void (*invoke)(void *, std::size_t, std::size_t);
+			std::size_t n_tasks;
+			std::atomic<std::size_t> next_task = 0;
+			/// threads other than the calling one working on the job, guarded by _nested_mutex
+			std::size_t n_helpers = 0;
+		};
+		
+		template<typename t_function>
+		void run_nested(std::size_t n_tasks, t_function &function)
+		{
+			nested_job job{const_cast<void *>(static_cast<const void *>(std::addressof(function))),
+			               [](void *job_function, std::size_t task_index, std::size_t thread_index)
+			               {
+				               (*static_cast<std::remove_reference_t<t_function> *>(job_function))(task_index, thread_index);
+			               },
+			               n_tasks};
+			{
+				std::lock_guard lock(_nested_mutex);
+				_nested_jobs.push_back(&job);
+			}
+			_nested_changed.notify_all();
+			
+			work_on_nested_job(job, _executing_thread_index);
+			
+			std::unique_lock lock(_nested_mutex);
+			_nested_jobs.erase(std::find(_nested_jobs.begin(), _nested_jobs.end(), &job));
+			_nested_changed.wait(lock, [&job]()
+			{
+				return job.n_helpers == 0;
+			});
+		}
+		
+		static void work_on_nested_job(nested_job &job, std::size_t thread_index)
+		{
+			for (std::size_t task_index = job.next_task.fetch_add(1, std::memory_order_relaxed); task_index < job.n_tasks;
+			     task_index = job.next_task.fetch_add(1, std::memory_order_relaxed))
+			{
+				job.invoke(job.function, task_index, thread_index);
+			}
+		}
+		
+		void worker_loop(std::size_t thread_index)
+		{
+			std::size_t seen_generation = 0;
+			std::unique_lock lock(_mutex);
+			while (true)
+			{
+				_wake_workers.wait(lock, [&]()
+				{
+					return _stop || _generation != seen_generation;
+				});
+				
+				if (_stop)
+				{
+					return;
+				}
+				
+				seen_generation = _generation;
+				++_n_busy_workers;
+				lock.unlock();
+				
+				work_on_tasks(thread_index);
+				
+				lock.lock();
+				--_n_busy_workers;
+				if (_n_busy_workers == 0)
+				{
+					_workers_done.notify_all();
+				}
+			}
+		}
+		
+		/// range of task indices [begin, end) packed into one word, so that the owner and thieves can update it with a single compare exchange
+		struct alignas(64) task_range
+		{
+			std::atomic<std::uint64_t> bounds = 0;
+		};
+		
+		[[nodiscard]]
+		static constexpr std::uint64_t pack_range(std::uint64_t begin, std::uint64_t end) noexcept
+		{
+			return begin | (end << 32);
+		}
+		
+		[[nodiscard]]
+		static constexpr std::uint32_t range_begin(std::uint64_t bounds) noexcept
+		{
+			return static_cast<std::uint32_t>(bounds);
+		}
+		
+		[[nodiscard]]
+		static constexpr std::uint32_t range_end(std::uint64_t bounds) noexcept
+		{
+			return static_cast<std::uint32_t>(bounds >> 32);
+		}
+		
+		void work_on_tasks(std::size_t thread_index)
+		{
+			const thread_pool *previous_pool = std::exchange(_executing_pool, this);
+			const std::size_t previous_thread_index = std::exchange(_executing_thread_index, thread_index);
+			while (true)
+			{
+				std::size_t task_index;
+				while (pop_own_task(thread_index, task_index))
+				{
+					_invoke_job(_job, task_index, thread_index);
+					_n_unfinished_tasks.fetch_sub(1, std::memory_order_release);
+				}
+				
+				if (not steal_tasks(thread_index))
+				{
+					_executing_pool = previous_pool;
+					_executing_thread_index = previous_thread_index;
+					return;
+				}
+			}
+		}
+		
+		/// takes the first task of the threads own range
+		bool pop_own_task(std::size_t thread_index, std::size_t &task_index)
+		{
+			std::atomic<std::uint64_t> &own_bounds = _task_ranges[thread_index].bounds;
+			std::uint64_t bounds = own_bounds.load(std::memory_order_acquire);
+			while (range_begin(bounds) < range_end(bounds))
+			{
+				if (own_bounds.compare_exchange_weak(bounds, pack_range(range_begin(bounds) + 1, range_end(bounds)), std::memory_order_acq_rel))
+				{
+					task_index = range_begin(bounds);
+					return true;
+				}
+			}
+			return false;
+		}
+		
+		/// moves the back half of the range of another thread into the, currently empty, range of this thread
+		/// \return false if all other threads are out of tasks as well
+		bool steal_tasks(std::size_t thread_index)
+		{
+			const std::size_t n_threads = thread_count();
+			for (std::size_t offset = 1; offset < n_threads; ++offset)
+			{
+				std::atomic<std::uint64_t> &victim_bounds = _task_ranges[(thread_index + offset) % n_threads].bounds;
+				std::uint64_t bounds = victim_bounds.load(std::memory_order_acquire);
+				while (range_begin(bounds) < range_end(bounds))
+				{
+					const std::uint32_t n_stolen = (range_end(bounds) - range_begin(bounds) + 1) / 2;
+					const std::uint32_t new_victim_end = range_end(bounds) - n_stolen;
+					if (victim_bounds.compare_exchange_weak(bounds, pack_range(range_begin(bounds), new_victim_end), std::memory_order_acq_rel))
+					{
+						// nobody steals from an empty range, so the own range can simply be replaced
+						_task_ranges[thread_index].bounds.store(pack_range(new_victim_end, range_end(bounds)), std::memory_order_release);
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+	
+	private:
+		std::vector<std::thread> _workers{};
+		
+		/// serializes calls to run
+		std::mutex _run_mutex{};
+		/// guards _generation, _stop and _n_busy_workers
+		std::mutex _mutex{};
+		std::condition_variable _wake_workers{};
+		std::condition_variable _workers_done{};
+		/// incremented for every job, lets workers tell a new job from a spurious wake up
+		std::size_t _generation = 0;
+		std::size_t _n_busy_workers = 0;
+		bool _stop = false;
+		
+		void *_job arch_ptr_init;
+		void (*_invoke_job)(void *, std::size_t, std::size_t) arch_ptr_init;
+		/// tasks not yet taken by a thread, one range per thread with the calling thread at index 0
+		std::unique_ptr<task_range[]> _task_ranges;
+		std::atomic<std::size_t> _n_unfinished_tasks = 0;
+		
+		/// guards _nested_jobs and the helpers of every nested job
+		std::mutex _nested_mutex{};
+		/// notified whenever a nested job gets added or loses its last helper, and by notify_helpers
+		std::condition_variable _nested_changed{};
+		/// nested jobs whose calling thread is still working on them
+		std::vector<nested_job *> _nested_jobs{};
+		
+		/// pool whose tasks the current thread is working on, used to detect nested calls to run
+		static inline thread_local const thread_pool *_executing_pool = nullptr;
+		static inline thread_local std::size_t _executing_thread_index = 0;
+	};
+}
@@ -255,6 +255,7 @@ namespace arch
 	{
 		type_id id;
 		std::size_t size;
+		std::size_t alignment;
 #if defined ARCH_VERBOSE_TYPE_INFO
 		std::string_view type_name;
 #endif
@@ -265,6 +266,7 @@ namespace arch
 			return {
 					{0},
 					0,
+					1,
 #if defined ARCH_VERBOSE_TYPE_INFO
 					"",
 #endif
@@ -278,6 +280,7 @@ namespace arch
 	{
 		return {id_of<T>(),
 		        sizeof(T),
+		        alignof(T),
 #if defined ARCH_VERBOSE_TYPE_INFO
 				name_of<T>(),
 #endif
@@ -296,6 +299,28 @@ namespace arch
 			}
 			return result;
 		}
+		
+		/// spreads the bits of value over the whole 64 bit range (finalizer of splitmix64)
+		[[nodiscard]]
+		constexpr std::uint64_t mix64(std::uint64_t value)
+		{
+			value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+			value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+			return value ^ (value >> 31);
+		}
+		
+		/// Calculates a 64 bit signature of a set of types that does not depend on the order of the types. Unlike combine_hashes, pairs of
+		/// types do not cancel each other out. Different sets can still share a signature, so equal signatures need to be confirmed
+		[[nodiscard]]
+		constexpr std::uint64_t signature_of(std::span<const type_id> types)
+		{
+			std::uint64_t result = 0;
+			for (type_id type: types)
+			{
+				result += mix64(type.value);
+			}
+			return result;
+		}
 	}
 }
 
@@ -8,13 +8,11 @@
 #include <type_traits>
 
 #include "system.hpp"
+#include "world.hpp"
 #include "internal/scheduler.hpp"
 
 namespace arch
 {
-	
-	class world;
-	
 	class update_group : system_base
 	{
 	public:
@@ -36,6 +34,12 @@ namespace arch
 			return {_contained_systems};
 		}
 		
+		/// \return the contained systems in execution order together with the dependencies between them
+		const det::job_graph<system_base> &get_system_graph() const
+		{
+			return _system_graph;
+		}
+		
 		void update_before(const system_base &system)
 		{
 			_following_system_names.push_back(system.get_system_name());
@@ -47,14 +51,22 @@ namespace arch
 		}
 	
 	public:
+		/// Executes all systems on the thread pool of the world. A system starts as soon as every system it depends on is finished, so
+		/// independent systems run in parallel. Systems that do not declare their component access never run at the same time as another one.
+		/// Systems running at the same time may only run queries on the world, structural changes have to go through command buffers.
+		/// Parallel queries inside systems use the threads that wait for a system to become ready. Observer events get delivered once all
+		/// systems are done
 		virtual void execute(world &execution_world) final
 		{
 			on_before_execute();
 			
-			for (system_base *system: _contained_systems)
+			// a system copying a shared chunk on its first write would race with the other systems using the chunk
+			execution_world.make_chunks_writable(_concurrently_written);
+			_system_graph.run(execution_world.get_thread_pool(), [&execution_world](system_base &system)
 			{
-				system->execute(execution_world);
-			}
+				system.execute(execution_world);
+			});
+			execution_world.deliver_observer_events();
 			
 			on_after_execute();
 		}
@@ -149,6 +161,7 @@ namespace arch
 		void reorder_systems()
 		{
 			_system_scheduler.clear();
+			_concurrently_written = {};
 			
 			std::unordered_map<std::size_t, system_base *> name_hash_to_system{};
 			auto hash = std::hash<std::string_view>();
@@ -190,7 +203,35 @@ namespace arch
 				_system_scheduler.add_job(*system, {previous_systems}, {following_systems});
 			}
 			
-			_contained_systems = _system_scheduler.schedule_jobs();
+			// systems that use the same components keep the order of the named dependencies, following that order can not create a cycle
+			std::vector<system_base *> named_order = _system_scheduler.schedule_jobs();
+			for (std::size_t later = 0; later < named_order.size(); ++later)
+			{
+				previous_systems.clear();
+				for (std::size_t earlier = 0; earlier < later; ++earlier)
+				{
+					const component_access &earlier_access = named_order[earlier]->get_component_access();
+					const component_access &later_access = named_order[later]->get_component_access();
+					if (earlier_access.conflicts_with(later_access))
+					{
+						previous_systems.push_back(named_order[earlier]);
+					}
+					else
+					{
+						_concurrently_written |= earlier_access.get_writes();
+						_concurrently_written |= later_access.get_writes();
+					}
+				}
+				_system_scheduler.add_job(*named_order[later], {previous_systems}, {});
+			}
+			
+			_system_graph = _system_scheduler.schedule_graph();
+			
+			_contained_systems.clear();
+			for (const auto &node: _system_graph.nodes())
+			{
+				_contained_systems.push_back(node.job);
+			}
 		}
 	
 	private:
@@ -199,6 +240,10 @@ namespace arch
 		std::vector<std::string_view> _following_system_names{};
 		
 		det::scheduler<system_base> _system_scheduler{};
+		/// systems in execution order plus the dependencies between them
+		det::job_graph<system_base> _system_graph{};
+		/// components written by systems that may run at the same time as another system
+		det::component_mask _concurrently_written{};
 		
 		friend class world;
 	};
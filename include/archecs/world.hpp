@@ -1,41 +1,52 @@
 #pragma once
 
 #include <array>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
 #include <vector>
 #include <span>
 #include <unordered_map>
+#include <memory>
 #include <memory_resource>
-#include <thread>
-#include <barrier>
 
 #include "type_id.hpp"
 #include "entity.hpp"
 #include "archetype.hpp"
+#include "query_cache.hpp"
+#include "thread_pool.hpp"
 #include "archecs/internal/helpers.hpp"
+#include "archecs/internal/archetype_index.hpp"
 
 namespace arch
 {
+	class entity_command_buffer;
+	class world_snapshot;
+	
+	namespace det
+	{
+		class mapped_file;
+	}
+	
 	class world
 	{
 	public:
+		/// receives a batch of entities, see on_add, on_remove and on_destroy
+		using observer_function = std::function<void(std::span<const entity>)>;
+		
+		/// Location of an entity inside the world. Slots of dead entities form a free list: their in_archetype_index stores the id of the next
+		/// dead entity and their version the version the id will have once it gets reused
 		struct entity_info
 		{
-			entity_info() = default;
-			
-			entity_info(entity identifier,
-			            std::size_t owning_archetype_index,
-			            std::size_t in_archetype_index)
-					: identifier(identifier),
-					  owning_archetype_index(owning_archetype_index),
-					  in_archetype_index(in_archetype_index)
-			{
-			}
-			
-			entity identifier;
-			std::size_t owning_archetype_index;
-			std::size_t in_archetype_index;
+			version_t version;
+			std::uint32_t owning_archetype_index;
+			std::uint32_t in_archetype_index;
 		};
 		
+		static_assert(sizeof(entity_info) == 12);
+		
 		[[nodiscard]]
 		entity_info &get_info(entity of_entity)
 		{
@@ -50,33 +61,323 @@ namespace arch
 	
 	public:
 		world()
+				: world(*std::pmr::get_default_resource())
+		{}
+		
+		/// Creates a world whose memory pools take their memory from upstream. upstream has to outlive the world, its forks and the worlds it
+		/// gets merged into, and has to be thread safe if the world gets forked
+		explicit world(std::pmr::memory_resource &upstream)
+				: _archetype_memory(POOL_OPTIONS, &upstream),
+				  _chunk_memory(std::make_shared<std::pmr::synchronized_pool_resource>(POOL_OPTIONS, &upstream))
 		{
 			// create base archetype
 			create_archetype_with_types<>();
 		}
+		
+		/// Creates a world that contains the same entities as this one and shares the memory of all chunks with it. A chunk only gets copied
+		/// once either world writes to it, so forking and reading the fork costs about as much as the chunks written afterwards. The fork
+		/// may be used on another thread than this world, for example to extract the state of a frame for rendering. Query caches, observers
+		/// and the thread pool are not part of the fork. All components have to be copyable, see is_copyable_component, otherwise this throws
+		/// std::invalid_argument
+		[[nodiscard]]
+		std::unique_ptr<world> fork()
+		{
+			throw_if_not_copyable();
+			return std::unique_ptr<world>(new world(*this, fork_tag{}));
+		}
+		
+		~world()
+		{
+			// captured chunks are released through their archetypes
+			set_rollback_capacity(0);
+		}
+		
+		/// Lets the world keep the last n_states states saved by capture_state, so that rollback can return to them. Drops all states captured
+		/// so far
+		void set_rollback_capacity(std::size_t n_states)
+		{
+			for (captured_state &state: _captured_states)
+			{
+				release_captured_state(state);
+			}
+			_captured_states.resize(n_states);
+			_newest_captured_state = 0;
+			_n_captured_states = 0;
+		}
+		
+		/// Saves the state of all entities into the rollback ring, replacing the oldest state once all set_rollback_capacity states are in use.
+		/// Chunks are shared with the state copy-on-write like by fork, so only chunks written to afterwards get copied. Of the entity index
+		/// only the pages changed since the replaced state got captured are copied. All components have to be copyable, see is_copyable_component,
+		/// otherwise this throws std::invalid_argument before anything gets captured
+		void capture_state()
+		{
+			arch_assert_external(not _captured_states.empty()); // call set_rollback_capacity first
+			throw_if_not_copyable();
+			
+			_newest_captured_state = (_newest_captured_state + 1) % _captured_states.size();
+			_n_captured_states = std::min(_n_captured_states + 1, _captured_states.size());
+			captured_state &state = _captured_states[_newest_captured_state];
+			
+			copy_changed_entity_pages(_entities, state.entities, state.tick);
+			state.first_dead_entity = _first_dead_entity;
+			state.archetype_chunks.resize(_archetypes.size());
+			for (std::size_t i = 0; i < _archetypes.size(); ++i)
+			{
+				_archetypes[i].internal().capture_chunks(state.archetype_chunks[i]);
+			}
+			
+			// later changes are newer than the captured state
+			state.tick = _change_tick++;
+		}
+		
+		/// \return the number of states rollback can return to
+		[[nodiscard]]
+		std::size_t captured_state_count() const noexcept
+		{
+			return _n_captured_states;
+		}
+		
+		/// Returns all entities, their components and the ids of dead entities to the state captured age calls to capture_state ago, 0 being the
+		/// last one. States captured after it are dropped. The chunks written to since the capture get replaced by the captured ones, so
+		/// changed filters see every component as changed the next time a query runs. Observers are not notified
+		void rollback(std::size_t age = 0)
+		{
+			arch_assert_external(age < _n_captured_states);
+			
+			for (std::size_t i = 0; i < age; ++i)
+			{
+				release_captured_state(_captured_states[_newest_captured_state]);
+				_newest_captured_state = (_newest_captured_state + _captured_states.size() - 1) % _captured_states.size();
+			}
+			_n_captured_states -= age;
+			captured_state &state = _captured_states[_newest_captured_state];
+			
+			// the world never contains less entity ids than the states captured before
+			arch_assert_internal(state.entities.size() <= _entities.size());
+			copy_changed_entity_pages(state.entities, _entities, state.tick);
+			add_entity_pages();
+			// pages changed after the capture changed again, which the other captured states need to see
+			for (det::change_tick &page_tick: _entity_page_ticks)
+			{
+				if (page_tick > state.tick)
+				{
+					page_tick = get_change_tick();
+				}
+			}
+			_first_dead_entity = state.first_dead_entity;
+			_last_rollback_tick = get_change_tick();
+			
+			for (std::size_t i = 0; i < _archetypes.size(); ++i)
+			{
+				std::span<det::chunk> captured_chunks{};
+				if (i < state.archetype_chunks.size())
+				{
+					captured_chunks = state.archetype_chunks[i];
+				}
+				_archetypes[i].internal().restore_chunks(captured_chunks);
+			}
+		}
+		
+		/// Moves all entities of source into this world, for example once a level finished loading into a world on another thread. Archetypes
+		/// are matched by their set of types and take over the chunks of source as a whole, only the rows filling up their last chunk get
+		/// copied. Besides that, only the entity ids stored inside the chunks and the entity index are touched. Merged entities get new ids,
+		/// their components count as changed and on_add observers get notified. Components referring to other entities have to be updated by
+		/// the caller using the returned table. source is left without entities and captured states
+		/// \return the entity every id of source got merged as, entity::null() for ids of dead entities
+		std::vector<entity> merge_from(world &&source)
+		{
+			arch_assert_external(&source != this);
+			
+			source.set_rollback_capacity(0);
+			std::size_t n_merged = 0;
+			for (const archetype &source_archetype: source._archetypes)
+			{
+				n_merged += source_archetype.size();
+			}
+			
+			allocate_entity_ids(n_merged);
+			std::vector<entity> remapped(source._entities.size(), entity::null());
+			std::size_t n_assigned = 0;
+			for (std::size_t id = 0; id < source._entities.size(); ++id)
+			{
+				if (source._entities[id].owning_archetype_index != DEAD_ARCHETYPE_INDEX)
+				{
+					remapped[id] = _created_entities[n_assigned++];
+				}
+			}
+			arch_assert_internal(n_assigned == n_merged);
+			
+			// the taken chunks still use the memory of source
+			if (source._chunk_memory != _chunk_memory)
+			{
+				_merged_chunk_memory.push_back(source._chunk_memory);
+			}
+			_merged_chunk_memory.insert(_merged_chunk_memory.end(), source._merged_chunk_memory.begin(), source._merged_chunk_memory.end());
+			_mapped_snapshots.insert(_mapped_snapshots.end(), source._mapped_snapshots.begin(), source._mapped_snapshots.end());
+			
+			for (archetype &source_archetype: source._archetypes)
+			{
+				if (source_archetype.size() == 0)
+				{
+					continue;
+				}
+				
+				std::span<const type_id> types = source_archetype.get_contained_types();
+				std::size_t target_archetype_index = _archetype_index.find(det::hashing::signature_of(types), types, _archetypes);
+				if (target_archetype_index == det::archetype_index::no_archetype)
+				{
+					create_archetype_like(source_archetype.internal());
+					target_archetype_index = _archetypes.size() - 1;
+				}
+				
+				det::archetype_internal &target_archetype = _archetypes[target_archetype_index].internal();
+				auto place_merged = [&](std::size_t chunk_index, std::size_t first_in_chunk_index, std::size_t n_entities)
+				{
+					std::span<const entity> merged = target_archetype.chunk_entities(chunk_index).subspan(first_in_chunk_index, n_entities);
+					const std::size_t first_merged_index = chunk_index * target_archetype.chunk_capacity() + first_in_chunk_index;
+					for (std::size_t i = 0; i < merged.size(); ++i)
+					{
+						_entities[merged[i].id] = {merged[i].version, static_cast<std::uint32_t>(target_archetype_index),
+						                           static_cast<std::uint32_t>(first_merged_index + i)};
+						mark_info_changed(merged[i].id);
+					}
+					
+					if (has_observers()) [[unlikely]]
+					{
+						record_component_set_change(merged, {}, target_archetype.get_component_mask());
+					}
+				};
+				const std::size_t first_in_archetype_index = target_archetype.take_entities_of(source_archetype.internal(), remapped);
+				target_archetype.for_each_chunk_range(first_in_archetype_index, target_archetype.size() - first_in_archetype_index, place_merged);
+			}
+			
+			source._entities.clear();
+			source._entity_page_ticks.clear();
+			source._first_dead_entity = NO_DEAD_ENTITY;
+			return remapped;
+		}
+	
+		/// Lets the chunks of the archetype containing exactly t_components... come from resource instead of the pool of the world, creating the
+		/// archetype if needed. For example a std::pmr::monotonic_buffer_resource that gets released together with a level, or a pool whose
+		/// upstream is a huge_page_resource. Chunks allocated before return their memory to where it came from. resource has to outlive the
+		/// world, its forks and the worlds it gets merged into, and has to be thread safe if the world gets forked
+		template<typename ...t_components>
+		requires (sizeof...(t_components) != 0)
+		void set_chunk_resource(std::pmr::memory_resource &resource)
+		{
+			constexpr std::array added_types = {info_of<t_components>()...};
+			constexpr std::array added_destructors = {det::multi_destructor_of<t_components>()...};
+			
+			const std::size_t archetype_index = get_or_create_archetype_index(BASE_ARCHETYPE_INDEX, added_types, added_destructors, {});
+			det::archetype_internal &changed_archetype = _archetypes[archetype_index].internal();
+			for (captured_state &state: _captured_states)
+			{
+				if (archetype_index < state.archetype_chunks.size())
+				{
+					changed_archetype.remember_chunk_resource(state.archetype_chunks[archetype_index]);
+				}
+			}
+			changed_archetype.change_chunk_resource(&resource);
+		}
 	
 	public:
 		[[nodiscard]]
 		entity create_entity()
 		{
 			entity new_entity;
-			if (_dead_entities.empty())
+			if (_first_dead_entity == NO_DEAD_ENTITY)
 			{
 				new_entity = {static_cast<entity_id_t>(_entities.size()), 0};
+				_entities.push_back({0, BASE_ARCHETYPE_INDEX, 0});
+				add_entity_pages();
 			}
 			else
 			{
-				new_entity = _dead_entities.back();
-				_dead_entities.pop_back();
+				const entity_info &reused_info = _entities[_first_dead_entity];
+				new_entity = {_first_dead_entity, reused_info.version};
+				_first_dead_entity = reused_info.in_archetype_index;
 			}
 			
 			archetype &owning_archetype = get_base_archetype();
-			std::size_t in_archetype_index = owning_archetype.internal().add_entity(new_entity);
-			_entities.emplace_back(new_entity, BASE_ARCHETYPE_INDEX, in_archetype_index);
+			entity_info &created_info = get_info(new_entity);
+			created_info.owning_archetype_index = BASE_ARCHETYPE_INDEX;
+			created_info.in_archetype_index = static_cast<std::uint32_t>(owning_archetype.internal().add_entity(new_entity));
+			mark_info_changed(new_entity.id);
 			
 			return new_entity;
 		}
 		
+		/// Creates count entities that do not have any components
+		/// \return the created entities. only valid until the next call to create_entities
+		std::span<const entity> create_entities(std::size_t count)
+		{
+			return create_entities_in(BASE_ARCHETYPE_INDEX, count);
+		}
+		
+		/// Creates count entities with default constructed components of the types t_components... directly inside their final archetype
+		/// \return the created entities. only valid until the next call to create_entities
+		template<typename ...t_components>
+		requires (sizeof...(t_components) != 0)
+		std::span<const entity> create_entities(std::size_t count)
+		{
+			return create_entities(count, t_components{}...);
+		}
+		
+		/// Creates count entities directly inside the archetype containing exactly t_components... Every component gets copy constructed from
+		/// the given initial values
+		/// \return the created entities. only valid until the next call to create_entities
+		template<typename ...t_components>
+		requires (sizeof...(t_components) != 0)
+		std::span<const entity> create_entities(std::size_t count, const t_components &...initial_values)
+		{
+			constexpr std::array added_types = {info_of<t_components>()...};
+			constexpr std::array added_destructors = {det::multi_destructor_of<t_components>()...};
+			
+			const std::size_t target_archetype_index = get_or_create_archetype_index(BASE_ARCHETYPE_INDEX, added_types, added_destructors, {});
+			std::span<const entity> created = create_entities_in(target_archetype_index, count);
+			if (count == 0)
+			{
+				return created;
+			}
+			
+			det::archetype_internal &target_archetype = _archetypes[target_archetype_index].internal();
+			const std::array column_indices = {target_archetype.column_index_of(id_of<t_components>())...};
+			const std::size_t first_in_archetype_index = get_info(created.front()).in_archetype_index;
+			
+			target_archetype.for_each_chunk_range(first_in_archetype_index, count,
+			                                      [&](std::size_t chunk_index, std::size_t first_in_chunk_index, std::size_t n_entities)
+			                                      {
+				                                      std::size_t column = 0;
+				                                      (fill_column(target_archetype, chunk_index, column_indices[column++], first_in_chunk_index, n_entities,
+				                                                   initial_values), ...);
+			                                      });
+			
+			return created;
+		}
+		
+		/// Creates count copies of prototype directly inside its archetype. Every component gets copy constructed from the one of prototype,
+		/// one column after another. All components of prototype have to be copyable, see is_copyable_component, otherwise this throws
+		/// std::invalid_argument before any entity gets created
+		/// \return the created entities. only valid until the next call to create_entities
+		std::span<const entity> instantiate(entity prototype, std::size_t count)
+		{
+			arch_assert_external(is_alive(prototype));
+			
+			const std::size_t archetype_index = get_info(prototype).owning_archetype_index;
+			if (not _archetypes[archetype_index].internal().is_copyable())
+			{
+				throw std::invalid_argument("instantiated entities may only have copyable components, see is_copyable_component");
+			}
+			std::span<const entity> created = create_entities_in(archetype_index, count);
+			if (count != 0)
+			{
+				const std::size_t first_in_archetype_index = get_info(created.front()).in_archetype_index;
+				_archetypes[archetype_index].internal().fill_with_copies_of(get_info(prototype).in_archetype_index, first_in_archetype_index, count);
+			}
+			
+			return created;
+		}
+		
 		void destroy_entity(entity entity_to_destroy)
 		{
 			if (not is_alive(entity_to_destroy))
@@ -84,14 +385,23 @@ namespace arch
 				return;
 			}
 			
-			auto &destroyed_entity_info = get_info(entity_to_destroy);
-			destroyed_entity_info.identifier.version += 1;
-			_dead_entities.push_back(destroyed_entity_info.identifier);
-			
+			entity_info &destroyed_entity_info = get_info(entity_to_destroy);
 			archetype &owning_archetype = _archetypes[destroyed_entity_info.owning_archetype_index];
+			if (has_observers()) [[unlikely]]
+			{
+				record_destroyed(entity_to_destroy, owning_archetype.get_component_mask());
+			}
 			
 			entity swapped_entity = owning_archetype.internal().remove_entity(destroyed_entity_info.in_archetype_index);
 			get_info(swapped_entity).in_archetype_index = destroyed_entity_info.in_archetype_index;
+			mark_info_changed(swapped_entity.id);
+			
+			// push the slot onto the free list
+			destroyed_entity_info.version += 1;
+			destroyed_entity_info.owning_archetype_index = DEAD_ARCHETYPE_INDEX;
+			destroyed_entity_info.in_archetype_index = _first_dead_entity;
+			_first_dead_entity = entity_to_destroy.id;
+			mark_info_changed(entity_to_destroy.id);
 		}
 		
 		[[nodiscard]]
@@ -102,7 +412,8 @@ namespace arch
 				return false;
 			}
 			
-			return get_info(entity_to_check).identifier.version == entity_to_check.version;
+			const entity_info &info = get_info(entity_to_check);
+			return info.version == entity_to_check.version && info.owning_archetype_index != DEAD_ARCHETYPE_INDEX;
 		}
 		
 		template<typename t_added_component>
@@ -200,8 +511,10 @@ namespace arch
 		{
 			arch_assert_internal(target_archetype.contains_type(type_info.id));
 			
-			void *target_data = target_archetype.get_component_data(entity_index, type_info.id);
-			std::memcpy(target_data, component_data, type_info.size);
+			det::archetype_internal &target_internal = target_archetype.internal();
+			const std::size_t column_index = target_internal.column_index_of(type_info.id);
+			target_internal.mark_column_changed(entity_index / target_internal.chunk_capacity(), column_index);
+			std::memcpy(target_internal.get_column_data(entity_index, column_index), component_data, type_info.size);
 		}
 		
 		void add_component(entity target_entity, type_info type_to_add, void *component_data, det::multi_destructor component_destructor)
@@ -213,37 +526,30 @@ namespace arch
 			}
 			
 			entity_info &current_info = get_info(target_entity);
-			archetype &previous_archetype = _archetypes[current_info.owning_archetype_index];
-			std::uint32_t previous_archetype_hash = previous_archetype.internal().get_combined_types_hash();
-			archetype &target_archetype = add_component(current_info, previous_archetype_hash, type_to_add, component_destructor);
+			archetype &target_archetype = add_component(target_entity, type_to_add, component_destructor);
 			
-			void *target_data = target_archetype.get_component_data(current_info.in_archetype_index, type_to_add.id);
+			// the entity was just moved into a writable chunk, which already counts as changed
+			void *target_data = target_archetype.internal().get_component_data(current_info.in_archetype_index, type_to_add.id);
 			std::memcpy(target_data, component_data, type_to_add.size);
 		}
 		
-		archetype &add_component(entity_info &arch_restrict info, std::uint32_t archetype_hash, type_info type_to_add, det::multi_destructor destructor)
+		/// moves an entity into the archetype that additionally contains type_to_add. WARNING: does not initialize the added component
+		archetype &add_component(entity target_entity, type_info type_to_add, det::multi_destructor destructor)
 		{
-			std::uint32_t target_archetype_hash = det::hashing::combine_hashes(archetype_hash, type_to_add.id.value);
-			const std::size_t previous_archetype_index = info.owning_archetype_index;
+			const std::size_t previous_archetype_index = get_info(target_entity).owning_archetype_index;
 			
-			auto archetype_search = _types_to_archetype.find(target_archetype_hash);
-			archetype *arch_restrict target_archetype;
-			if (archetype_search != _types_to_archetype.end())
+			const det::archetype_transition *transition = _archetypes[previous_archetype_index].internal().find_add_edge(type_to_add.id);
+			if (transition == nullptr) [[unlikely]]
 			{
-				target_archetype = &_archetypes[archetype_search->second];
-				info.owning_archetype_index = archetype_search->second;
-			}
-			else
-			{
-				target_archetype = &create_archetype_from_base_with(info.owning_archetype_index,
-				                                                    {&type_to_add, &type_to_add + 1},
-				                                                    {&destructor, &destructor + 1},
-				                                                    {});
-				info.owning_archetype_index = _archetypes.size() - 1;
+				const std::size_t target_archetype_index = get_or_create_archetype_index(previous_archetype_index,
+				                                                                         {&type_to_add, 1}, {&destructor, 1}, {});
+				transition = &_archetypes[previous_archetype_index].internal().cache_add_edge(type_to_add.id,
+				                                                                              _archetypes[target_archetype_index].internal(),
+				                                                                              target_archetype_index);
 			}
 			
-			move_entity_to(info.identifier, previous_archetype_index, *target_archetype);
-			return *target_archetype;
+			move_entity_to(target_entity, *transition);
+			return _archetypes[transition->target_archetype_index];
 		}
 		
 		void remove_component(entity target_entity, type_id to_remove)
@@ -255,72 +561,56 @@ namespace arch
 				return;
 			}
 			
-			entity_info &info = get_info(target_entity);
-			const std::size_t previous_archetype_index = info.owning_archetype_index;
-			
-			// get or create archetype
-			const std::uint32_t previous_archetype_hash = _archetypes[info.owning_archetype_index].internal().get_combined_types_hash();
-			const std::uint32_t target_archetype_hash = det::hashing::combine_hashes(to_remove.value, previous_archetype_hash);
+			const std::size_t previous_archetype_index = get_info(target_entity).owning_archetype_index;
 			
-			auto archetype_search = _types_to_archetype.find(target_archetype_hash);
-			archetype *target_archetype;
-			if (archetype_search != _types_to_archetype.end())
-			{
-				target_archetype = &_archetypes[archetype_search->second];
-				info.owning_archetype_index = archetype_search->second;
-			}
-			else
+			const det::archetype_transition *transition = _archetypes[previous_archetype_index].internal().find_remove_edge(to_remove);
+			if (transition == nullptr) [[unlikely]]
 			{
-				target_archetype = &create_archetype_from_base_with(previous_archetype_index, {}, {}, {&to_remove, &to_remove + 1});
-				info.owning_archetype_index = _archetypes.size() - 1;
+				const std::size_t target_archetype_index = get_or_create_archetype_index(previous_archetype_index, {}, {}, {&to_remove, 1});
+				transition = &_archetypes[previous_archetype_index].internal().cache_remove_edge(to_remove,
+				                                                                                 _archetypes[target_archetype_index].internal(),
+				                                                                                 target_archetype_index);
 			}
 			
-			move_entity_to(target_entity, previous_archetype_index, *target_archetype);
+			move_entity_to(target_entity, *transition);
 		}
 		
 		/// changes the archetype of a given entity. WARNING: does not initialize added components
 		void modify_component_set(entity target_entity, std::span<const type_info> added_types, std::span<const det::multi_destructor> added_types_destructors,
 		                          std::span<const type_id> removed_types)
 		{
-			using det::hashing::combine_hashes;
-			
 			arch_assert_external(is_alive(target_entity));
 			arch_assert_external(added_types.size() == added_types_destructors.size());
 			
 			entity_info &info = get_info(target_entity);
-			const std::size_t previous_archetype_index = info.owning_archetype_index;
-			std::uint32_t previous_archetype_hash = _archetypes[info.owning_archetype_index].internal().get_combined_types_hash();
-			
-			std::uint32_t target_archetype_hash = combine_hashes(combine_hashes(added_types), combine_hashes(removed_types));
-			target_archetype_hash = combine_hashes(target_archetype_hash, previous_archetype_hash);
 			
-			auto archetype_search = _types_to_archetype.find(target_archetype_hash);
-			archetype *target_archetype;
-			if (archetype_search != _types_to_archetype.end())
+			// single component changes can use the edges of the archetype
+			if (added_types.size() == 1 && removed_types.empty())
 			{
-				target_archetype = &_archetypes[archetype_search->second];
-				info.owning_archetype_index = archetype_search->second;
+				if (not has_component(target_entity, added_types[0].id))
+				{
+					add_component(target_entity, added_types[0], added_types_destructors[0]);
+				}
+				return;
 			}
-			else
+			else if (added_types.empty() && removed_types.size() == 1)
 			{
-				target_archetype = &create_archetype_from_base_with(previous_archetype_index, added_types, added_types_destructors, removed_types);
-				info.owning_archetype_index = _archetypes.size() - 1;
+				remove_component(target_entity, removed_types[0]);
+				return;
 			}
 			
-			move_entity_to(target_entity, previous_archetype_index, *target_archetype);
+			const std::size_t previous_archetype_index = info.owning_archetype_index;
+			const std::size_t target_archetype_index = get_or_create_archetype_index(previous_archetype_index, added_types, added_types_destructors,
+			                                                                         removed_types);
+			
+			move_entity_to(target_entity, get_transition(previous_archetype_index, target_archetype_index));
 		}
 		
 		template<typename t_component>
 		[[nodiscard]]
 		t_component &get_component(entity of_entity)
 		{
-			arch_assert_external(is_alive(of_entity));
-			
-			entity_info info = get_info(of_entity);
-			
-			auto &entities_archetype = _archetypes[info.owning_archetype_index];
-			void *component_data = entities_archetype.get_component_data(info.in_archetype_index, id_of<t_component>());
-			return *reinterpret_cast<t_component *>(component_data);
+			return *reinterpret_cast<t_component *>(get_component(of_entity, id_of<t_component>()));
 		}
 		
 		template<typename t_component>
@@ -343,8 +633,12 @@ namespace arch
 			
 			entity_info info = get_info(of_entity);
 			
-			auto &entities_archetype = _archetypes[info.owning_archetype_index];
-			return entities_archetype.get_component_data(info.in_archetype_index, component_type);
+			// the caller may write to the component, so it counts as changed
+			det::archetype_internal &entities_archetype = _archetypes[info.owning_archetype_index].internal();
+			const std::size_t column_index = entities_archetype.column_index_of(component_type);
+			arch_assert_external(column_index != det::archetype_internal::no_column);
+			entities_archetype.mark_column_changed(info.in_archetype_index / entities_archetype.chunk_capacity(), column_index);
+			return entities_archetype.get_column_data(info.in_archetype_index, column_index);
 		}
 		
 		[[nodiscard]]
@@ -395,158 +689,611 @@ namespace arch
 			return _archetypes[info.owning_archetype_index];
 		}
 		
+		/// Gets the cache of all archetypes matching t_filter, creating it on first use. The cache stays valid for the lifetime of the world
+		/// and gets updated whenever a new archetype is created
+		template<typename t_filter>
+		const query_cache<t_filter> &query(t_filter = {})
+		{
+			return get_query_cache<t_filter>();
+		}
+		
+		/// Calls function for every entity matching the filter. Components the function takes by non const reference or pointer mark their
+		/// column as changed, see changed_q
+		template<typename t_filter, typename t_function>
+		void for_all(t_filter filter, t_function &&function)
+		{
+			static_assert(t_filter::changed_components::size() == 0, "queries with changed filters need a change_tracker");
+			change_tracker untracked{};
+			for_all(filter, untracked, function);
+		}
+		
+		/// Like for_all, but chunks only pass the changed filters if they changed since the last query that used tracker
 		template<typename t_filter, typename t_function>
-		void for_all(t_filter, t_function &&function)
+		void for_all(t_filter, change_tracker &tracker, t_function &&function)
 		{
 			using searched_types = typename t_filter::resulting_components;
-			for (archetype &curr_archetype: _archetypes)
+			
+			auto &cached_query = get_query_cache<t_filter>();
+			const det::change_tick last_run_tick = last_run_tick_of(tracker);
+			const det::change_tick run_tick = begin_query_run<t_filter>();
+			for (const auto &matched: cached_query.matched_archetypes())
 			{
-				std::span<const type_id> contained_types = curr_archetype.get_contained_types();
-				if (t_filter::filter(contained_types))
-				{
-					apply_foreach_function_to_archetype(curr_archetype, function, searched_types{});
-				}
+				apply_foreach_function_to_archetype<t_filter>(matched, last_run_tick, own_write_tick<t_filter>(run_tick), function, searched_types{});
 			}
+			finish_query_run<t_filter>(tracker, run_tick);
 		}
 		
-		template<typename t_function>
-		void for_all_with(t_function &&function)
+		/// Calls function once for every chunk of the archetypes matching the filter. It receives the entities of the chunk followed by one span
+		/// per component of the filter, in the order of the filter. Optional components are passed as empty spans if the chunk does not contain them
+		template<typename t_filter, typename t_function>
+		void for_each_chunk(t_filter filter, t_function &&function)
 		{
-			for_all_with_impl(arch_fwd(function), det::arguments_of<t_function>());
+			static_assert(t_filter::changed_components::size() == 0, "queries with changed filters need a change_tracker");
+			change_tracker untracked{};
+			for_each_chunk(filter, untracked, function);
 		}
 		
+		/// Like for_each_chunk, but chunks only pass the changed filters if they changed since the last query that used tracker
 		template<typename t_filter, typename t_function>
-		void for_all_parallel(std::size_t n_threads, t_filter, t_function &&function)
+		void for_each_chunk(t_filter, change_tracker &tracker, t_function &&function)
 		{
 			using searched_types = typename t_filter::resulting_components;
 			
-			std::vector<std::thread> threads{};
-			threads.reserve(n_threads);
-			std::span<archetype> archetypes = _archetypes;
-			std::atomic<std::size_t> current_archetype_index = 0;
-			while (current_archetype_index < archetypes.size())
+			auto &cached_query = get_query_cache<t_filter>();
+			const det::change_tick last_run_tick = last_run_tick_of(tracker);
+			const det::change_tick run_tick = begin_query_run<t_filter>();
+			for (const auto &matched: cached_query.matched_archetypes())
 			{
-				auto contained_types = archetypes[current_archetype_index].get_contained_types();
-				if (t_filter::filter(contained_types))
+				apply_chunk_function_to_archetype<t_filter>(matched, last_run_tick, own_write_tick<t_filter>(run_tick), function, searched_types{});
+			}
+			finish_query_run<t_filter>(tracker, run_tick);
+		}
+		
+		/// \return the current tick of the world. Written columns store it, it advances every time a query with a changed filter starts
+		[[nodiscard]]
+		det::change_tick get_change_tick() const noexcept
+		{
+			return _change_tick.load(std::memory_order_relaxed);
+		}
+		
+		template<typename t_function>
+		void for_all_with(t_function &&function)
+		{
+			for_all_with_impl(arch_fwd(function), det::arguments_of<t_function>());
+		}
+		
+		/// Copies the chunks of all archetypes containing one of components that are still shared with a fork or a captured state. Systems
+		/// writing different components of the same chunk at the same time would otherwise each copy the chunk on their first write
+		void make_chunks_writable(const det::component_mask &components)
+		{
+			for (archetype &current: _archetypes)
+			{
+				if (current.internal().get_component_mask().intersects(components))
 				{
-					break;
+					current.internal().make_chunks_writable();
 				}
-				current_archetype_index.fetch_add(1);
+			}
+		}
+		
+		/// Lets the world run parallel queries on the given pool instead of creating its own one. The pool has to outlive the world
+		void set_thread_pool(thread_pool &pool)
+		{
+			_thread_pool = &pool;
+		}
+		
+		/// \return the pool parallel queries run on. If none was set, a pool with thread_pool::default_worker_count() workers is created on first use
+		[[nodiscard]]
+		thread_pool &get_thread_pool()
+		{
+			if (_thread_pool == nullptr)
+			{
+				_owned_thread_pool = std::make_unique<thread_pool>();
+				_thread_pool = _owned_thread_pool.get();
+			}
+			return *_thread_pool;
+		}
+		
+		/// Registers function to be called with all entities that got a component of type t_component, either by adding it or by getting created
+		/// with it. Events are queued and delivered in batches by deliver_observer_events, the entities may have changed again in between.
+		/// Observers registered by other observers only get the events queued after the current delivery finished
+		template<typename t_component>
+		void on_add(observer_function function)
+		{
+			register_observer({std::move(function), det::component_index_of<t_component>(), &observed_component::on_added});
+		}
+		
+		/// Registers function to be called with all entities that lost a component of type t_component, including destroyed entities. Events are
+		/// queued and delivered in batches by deliver_observer_events
+		template<typename t_component>
+		void on_remove(observer_function function)
+		{
+			register_observer({std::move(function), det::component_index_of<t_component>(), &observed_component::on_removed});
+		}
+		
+		/// Registers function to be called with all destroyed entities. Events are queued and delivered in batches by deliver_observer_events
+		void on_destroy(observer_function function)
+		{
+			register_observer({std::move(function), 0, nullptr});
+		}
+		
+		/// Calls the observers with all events queued since the last delivery: first the added and removed entities of every observed component,
+		/// in the order the components were first observed, then the destroyed entities. Events caused by observers get delivered before this
+		/// returns. update_group calls this after all of its systems finished
+		void deliver_observer_events()
+		{
+			// observers calling this are already inside the loop below, which picks up their events
+			if (_delivering_observer_events)
+			{
+				return;
 			}
 			
-			auto on_archetype_done = [&]()
+			_delivering_observer_events = true;
+			bool delivered_any = true;
+			while (delivered_any)
 			{
-				current_archetype_index.fetch_add(1);
-				while (current_archetype_index < archetypes.size())
+				delivered_any = false;
+				for (std::size_t i = 0; i < _observed_components.size(); ++i)
+				{
+					delivered_any |= deliver_events(_observed_components[i].added, &observed_component::on_added, i);
+					delivered_any |= deliver_events(_observed_components[i].removed, &observed_component::on_removed, i);
+				}
+				if (not _destroyed_entities.empty())
 				{
-					auto contained_types = archetypes[current_archetype_index].get_contained_types();
-					if (t_filter::filter(contained_types))
+					_delivered_entities.swap(_destroyed_entities);
+					_destroyed_entities.clear();
+					for (std::size_t i = 0; i < _destroy_observers.size(); ++i)
 					{
-						return;
+						_destroy_observers[i](_delivered_entities);
 					}
-					current_archetype_index.fetch_add(1);
+					delivered_any = true;
 				}
-			};
-			
-			std::barrier sync(n_threads, on_archetype_done);
-			
-			
-			for (std::size_t thread_id = 0; thread_id < n_threads; ++thread_id)
-			{
-				threads.emplace_back(
-						[&current_archetype_index, &function, archetypes, n_threads, thread_id, &sync]()
-						{
-							while (current_archetype_index < archetypes.size())
-							{
-								apply_foreach_function_parallel(function, t_filter(), searched_types(), archetypes[current_archetype_index], thread_id);
-								
-								sync.arrive_and_wait();
-							}
-						});
 			}
+			_delivering_observer_events = false;
 			
-			for (auto &thread: threads)
+			for (pending_observer &pending: _pending_observers)
 			{
-				thread.join();
+				register_observer(std::move(pending));
 			}
+			_pending_observers.clear();
 		}
-	
-	private:
-		template<typename t_function, typename ...t_args>
-		void for_all_with_impl(t_function &&function, det::type_list<entity, t_args...>)
+		
+		/// Like for_all, but the matching entities are split into ranges of rows that are processed in parallel on the worlds thread pool.
+		/// All matching archetypes are handled by one job, so small archetypes do not leave threads idle. function may be called from
+		/// multiple threads at once
+		template<typename t_filter, typename t_function>
+		void for_all_parallel(t_filter filter, t_function &&function)
 		{
-			using searched_types = typename det::type_list<t_args...>;
-			// currently we can simply deduct all needed types from non pointer arguments
-			constexpr std::array required_type_ids = ids_of_non_pointers<t_args...>();
-			for (archetype &curr_archetype: _archetypes)
-			{
-				std::span<const type_id> contained_types = curr_archetype.get_contained_types();
-				if (contains_ids(contained_types, required_type_ids))
-				{
-					apply_foreach_function_to_archetype(curr_archetype, function, searched_types{});
-				}
-			}
+			static_assert(t_filter::changed_components::size() == 0, "queries with changed filters need a change_tracker");
+			change_tracker untracked{};
+			for_all_parallel(filter, untracked, function);
 		}
 		
-		template<typename t_function, typename ...t_components>
-		static void apply_foreach_function_to_archetype(archetype &arch_restrict current_archetype, t_function &function,
-		                                                det::type_list<t_components...> type_list)
+		/// Like for_all_parallel, but chunks only pass the changed filters if they changed since the last query that used tracker
+		template<typename t_filter, typename t_function>
+		void for_all_parallel(t_filter, change_tracker &tracker, t_function &&function)
 		{
-			static_assert(std::is_invocable_v<t_function, entity, t_components...>,
-			              "Types of function does not match with the ones of the query. Are you missing an arch:entity as the first parameter?");
+			using searched_types = typename t_filter::resulting_components;
 			
-			constexpr std::array wanted_types = ids_of<t_components...>();
-			std::array<det::rtt_vector *, sizeof...(t_components)> component_vectors;
+			auto &cached_query = get_query_cache<t_filter>();
+			const det::change_tick last_run_tick = last_run_tick_of(tracker);
+			const det::change_tick run_tick = begin_query_run<t_filter>();
+			std::span matched_archetypes = cached_query.matched_archetypes();
+			thread_pool &pool = get_thread_pool();
+			
+			std::size_t n_entities = 0;
+			for (const auto &matched: matched_archetypes)
+			{
+				n_entities += _archetypes[matched.archetype_index].size();
+			}
+			
+			// aim for a couple of tasks per thread so that stealing can even out uneven work
+			const std::size_t n_wanted_tasks = pool.thread_count() * PARALLEL_TASKS_PER_THREAD;
+			const std::size_t grain_size = std::max(MIN_PARALLEL_GRAIN_SIZE, (n_entities + n_wanted_tasks - 1) / n_wanted_tasks);
+			
+			// systems may run parallel queries at the same time, so every call has its own tasks
+			std::vector<parallel_task> tasks{};
+			for (std::size_t matched_index = 0; matched_index < matched_archetypes.size(); ++matched_index)
 			{
-				std::span<det::rtt_vector> archetype_component_vectors = current_archetype.internal().component_vectors();
-				auto archetype_types = current_archetype.get_contained_types();
-				std::size_t vectors_index = 0;
-				for (std::size_t wanted_types_index = 0; wanted_types_index < wanted_types.size(); ++wanted_types_index)
+				const auto &matched = matched_archetypes[matched_index];
+				det::archetype_internal &current_archetype = _archetypes[matched.archetype_index].internal();
+				std::span<const det::chunk> chunks = current_archetype.chunks();
+				for (std::size_t chunk_index = 0; chunk_index < chunks.size(); ++chunk_index)
 				{
-					// search for next type
-					while (archetype_types[vectors_index] < wanted_types[wanted_types_index])
+					if (not chunk_passes_change_filter<t_filter>(current_archetype, chunk_index, matched.changed_column_indices, last_run_tick))
 					{
-						++vectors_index;
+						continue;
 					}
 					
-					if (archetype_types[vectors_index] != wanted_types[wanted_types_index])
-					{
-						// optional type was not found
-						component_vectors[wanted_types_index] = nullptr;
-					}
-					else
+					// tasks of the same chunk run concurrently, so the chunk is marked before any of them starts
+					mark_written_columns<t_function>(current_archetype, chunk_index, matched.column_indices, searched_types{},
+					                                 foreach_arguments_of(searched_types{}), own_write_tick<t_filter>(run_tick));
+					for (std::size_t first = 0; first < chunks[chunk_index].size; first += grain_size)
 					{
-						component_vectors[wanted_types_index] = &archetype_component_vectors[vectors_index];
-						++vectors_index;
+						tasks.push_back({matched_index, chunk_index, first, std::min(first + grain_size, chunks[chunk_index].size)});
 					}
 				}
 			}
 			
-			std::span<const entity> entities = current_archetype.entities();
-			std::size_t archetype_size = current_archetype.size();
-			for (std::size_t i = 0; i < archetype_size; ++i)
+			pool.run(tasks.size(), [&](std::size_t task_index, std::size_t)
 			{
-				apply_foreach_function_to_entity(function, i, entities, component_vectors, type_list, std::make_index_sequence<sizeof...(t_components)>());
-			}
+				const parallel_task task = tasks[task_index];
+				const auto &matched = matched_archetypes[task.matched_index];
+				apply_foreach_function_parallel(function, searched_types(), _archetypes[matched.archetype_index], matched.column_indices,
+				                                task.chunk_index, task.first_in_chunk_index, task.end_in_chunk_index);
+			});
+			finish_query_run<t_filter>(tracker, run_tick);
+		}
+	
+	private:
+		template<typename t_function, typename ...t_args>
+		void for_all_with_impl(t_function &&function, det::type_list<entity, t_args...>)
+		{
+			// currently we can simply deduct all needed types from non pointer arguments
+			for_all(det::arguments_q<t_args...>(), function);
 		}
 		
-		template<std::size_t array_size>
-		[[nodiscard]]
-		static consteval std::array<std::size_t, array_size> map_type_indices(std::array<type_id, array_size> from, std::array<type_id, array_size> to)
+		/// all observers of one component type together with the events queued for them
+		struct observed_component
 		{
-			std::array<std::size_t, array_size> mapped_indices{};
-			
-			for (std::size_t i = 0; i < array_size; ++i)
+			std::size_t component_index;
+			std::vector<observer_function> on_added{};
+			std::vector<observer_function> on_removed{};
+			std::vector<entity> added{};
+			std::vector<entity> removed{};
+		};
+		
+		/// throws std::invalid_argument if an archetype containing entities has components that can not be copied. Their chunks can not be
+		/// shared, since the first write to a shared chunk copies it
+		void throw_if_not_copyable() const
+		{
+			for (const archetype &current_archetype: _archetypes)
 			{
-				auto found = std::find(to.begin(), to.end(), from[i]);
-				
-				if (found == to.end())
+				if (current_archetype.chunk_count() != 0 && not current_archetype.internal().is_copyable())
 				{
-					throw std::exception();
+					throw std::invalid_argument("forked or captured worlds may only contain copyable components, see is_copyable_component");
 				}
-				else
-				{
-					std::size_t to_index = found - to.begin();
+			}
+		}
+		
+		/// an observer registered while observers get called, which is added once they are done
+		struct pending_observer
+		{
+			observer_function function;
+			std::size_t component_index;
+			/// the observers of the component function gets added to, nullptr for destroy observers
+			std::vector<observer_function> observed_component::*observers;
+		};
+		
+		[[nodiscard]]
+		bool has_observers() const noexcept
+		{
+			return not _observed_components.empty() || not _destroy_observers.empty();
+		}
+		
+		/// adds the observer, or delays it until the current delivery finished. Observers are called in place, so registering them right away
+		/// could reallocate the vector of the one currently running
+		void register_observer(pending_observer &&registered)
+		{
+			if (_delivering_observer_events)
+			{
+				_pending_observers.push_back(std::move(registered));
+			}
+			else if (registered.observers == nullptr)
+			{
+				_destroy_observers.push_back(std::move(registered.function));
+			}
+			else
+			{
+				(get_observed_component(registered.component_index).*registered.observers).push_back(std::move(registered.function));
+			}
+		}
+		
+		observed_component &get_observed_component(std::size_t component_index)
+		{
+			auto found = std::find_if(_observed_components.begin(), _observed_components.end(), [component_index](const observed_component &observed)
+			{
+				return observed.component_index == component_index;
+			});
+			if (found == _observed_components.end())
+			{
+				return _observed_components.emplace_back(observed_component{component_index});
+			}
+			return *found;
+		}
+		
+		/// queues the add and remove events of entities whose component set changed from previous to next
+		void record_component_set_change(std::span<const entity> entities, const det::component_mask &previous, const det::component_mask &next)
+		{
+			for (observed_component &observed: _observed_components)
+			{
+				const bool had_component = previous.test(observed.component_index);
+				const bool has_component = next.test(observed.component_index);
+				if (has_component && not had_component && not observed.on_added.empty())
+				{
+					observed.added.insert(observed.added.end(), entities.begin(), entities.end());
+				}
+				else if (had_component && not has_component && not observed.on_removed.empty())
+				{
+					observed.removed.insert(observed.removed.end(), entities.begin(), entities.end());
+				}
+			}
+		}
+		
+		/// queues the destroy event of an entity and the remove events of all of its components
+		void record_destroyed(entity destroyed, const det::component_mask &components)
+		{
+			record_component_set_change({&destroyed, 1}, components, {});
+			if (not _destroy_observers.empty())
+			{
+				_destroyed_entities.push_back(destroyed);
+			}
+		}
+		
+		/// hands the queued events to the observers of the observed component with the given index
+		/// \return false if there were no events
+		bool deliver_events(std::vector<entity> &queued, std::vector<observer_function> observed_component::*observers, std::size_t observed_index)
+		{
+			if (queued.empty())
+			{
+				return false;
+			}
+			
+			// observers can queue new events, so they get a copy of the current ones
+			_delivered_entities.swap(queued);
+			queued.clear();
+			for (std::size_t i = 0; i < (_observed_components[observed_index].*observers).size(); ++i)
+			{
+				(_observed_components[observed_index].*observers)[i](_delivered_entities);
+			}
+			return true;
+		}
+		
+		template<typename t_filter>
+		query_cache<t_filter> &get_query_cache()
+		{
+			const std::size_t filter_slot = det::filter_slot_of<t_filter>();
+			std::lock_guard lock(_query_caches_mutex);
+			auto found = _query_caches.find(filter_slot);
+			if (found == _query_caches.end())
+			{
+				found = _query_caches.emplace(filter_slot, std::make_unique<query_cache<t_filter>>(_archetypes)).first;
+			}
+			
+			return static_cast<query_cache<t_filter> &>(*found->second);
+		}
+		
+		/// \return the tick changes have to be stamped with at least to pass changed filters. chunks returned to an earlier state by rollback keep
+		/// their ticks, so trackers that last ran before the rollback see everything
+		[[nodiscard]]
+		det::change_tick last_run_tick_of(const change_tracker &tracker) const noexcept
+		{
+			return tracker._last_run_tick <= _last_rollback_tick ? 0 : tracker._last_run_tick;
+		}
+		
+		/// advances the tick before a query with changed filters visits any chunk. Everything written from then on, also by systems running at
+		/// the same time, is stamped with the returned tick or a later one. The query itself writes with the tick before it, see own_write_tick
+		/// \return the tick the next run of the query has to see changes from
+		template<typename t_filter>
+		det::change_tick begin_query_run()
+		{
+			if constexpr (t_filter::changed_components::size() != 0)
+			{
+				return _change_tick.fetch_add(2, std::memory_order_relaxed) + 2;
+			}
+			else
+			{
+				return 0;
+			}
+		}
+		
+		/// \return the tick a query stamps the columns it writes with. Queries with changed filters use the tick reserved by begin_query_run, so
+		/// that their next run does not see their own writes as changes. Others return 0 and stamp with the current tick
+		template<typename t_filter>
+		[[nodiscard]]
+		static det::change_tick own_write_tick(det::change_tick run_tick) noexcept
+		{
+			if constexpr (t_filter::changed_components::size() != 0)
+			{
+				return run_tick - 1;
+			}
+			else
+			{
+				return 0;
+			}
+		}
+		
+		/// remembers when a query with changed filters started, so that the next run with the same tracker only visits the chunks changed after
+		/// this one started
+		template<typename t_filter>
+		void finish_query_run(change_tracker &tracker, det::change_tick run_tick)
+		{
+			if constexpr (t_filter::changed_components::size() != 0)
+			{
+				tracker._last_run_tick = run_tick;
+			}
+		}
+		
+		/// \return if the chunk passes the changed filters of t_filter, checking the columns of changed_components against the last run of the query
+		template<typename t_filter, std::size_t n_changed>
+		[[nodiscard]]
+		static bool chunk_passes_change_filter(const det::archetype_internal &current_archetype, std::size_t chunk_index,
+		                                       const std::array<std::size_t, n_changed> &changed_column_indices, det::change_tick last_run_tick)
+		{
+			if constexpr (n_changed == 0)
+			{
+				return true;
+			}
+			else
+			{
+				std::array<bool, n_changed> changed;
+				for (std::size_t i = 0; i < n_changed; ++i)
+				{
+					changed[i] = current_archetype.column_change_tick(chunk_index, changed_column_indices[i]) >= last_run_tick;
+				}
+				return t_filter::chunk_matches(changed);
+			}
+		}
+		
+		/// marks the columns of all components function may write to as changed
+		/// \tparam t_arguments types the components are passed to function as, starting at its second parameter
+		/// \param write_tick the tick to stamp the columns with, see own_write_tick. 0 stamps them with the current tick
+		template<typename t_function, typename ...t_components, typename ...t_arguments>
+		static void mark_written_columns(det::archetype_internal &current_archetype, std::size_t chunk_index,
+		                                 [[maybe_unused]] std::span<const std::size_t, sizeof...(t_components)> column_indices, det::type_list<t_components...>,
+		                                 det::type_list<t_arguments...>, [[maybe_unused]] det::change_tick write_tick)
+		{
+			// function parameters are unsorted but columns are sorted by type_id, so we need to map the indices
+			[[maybe_unused]] constexpr std::array parameter_indices = map_type_indices({id_of<t_components>()...}, ids_of<t_components...>());
+			constexpr std::array<bool, sizeof...(t_components)> written = []<std::size_t ...is>(std::index_sequence<is...>)
+			{
+				return std::array<bool, sizeof...(t_components)>{(det::is_writable_argument<t_arguments> && det::may_write_argument<t_function, 1 + is>())...};
+			}(std::make_index_sequence<sizeof...(t_components)>());
+			
+			for (std::size_t i = 0; i < written.size(); ++i)
+			{
+				const std::size_t column_index = column_indices[parameter_indices[i]];
+				if (written[i] && column_index != det::archetype_internal::no_column)
+				{
+					if (write_tick == 0)
+					{
+						current_archetype.mark_column_changed(chunk_index, column_index);
+					}
+					else
+					{
+						current_archetype.mark_column_changed(chunk_index, column_index, write_tick);
+					}
+				}
+			}
+		}
+		
+		template<typename t_filter, typename t_function, typename ...t_components>
+		void apply_foreach_function_to_archetype(const typename query_cache<t_filter>::matched_archetype &matched, det::change_tick last_run_tick,
+		                                         det::change_tick write_tick, t_function &function, det::type_list<t_components...> type_list)
+		{
+			static_assert(std::is_invocable_v<t_function, entity, t_components...>,
+			              "Types of function does not match with the ones of the query. Are you missing an arch:entity as the first parameter?");
+			
+			archetype &current_archetype = _archetypes[matched.archetype_index];
+			const std::size_t n_chunks = current_archetype.chunk_count();
+			for (std::size_t chunk_index = 0; chunk_index < n_chunks; ++chunk_index)
+			{
+				if (not chunk_passes_change_filter<t_filter>(current_archetype.internal(), chunk_index, matched.changed_column_indices, last_run_tick))
+				{
+					continue;
+				}
+				
+				mark_written_columns<t_function>(current_archetype.internal(), chunk_index, matched.column_indices, type_list, foreach_arguments_of(type_list),
+				                                 write_tick);
+				apply_foreach_function_to_chunk(function, current_archetype, chunk_index, 0, current_archetype.chunks()[chunk_index].size,
+				                                matched.column_indices, type_list);
+			}
+		}
+		
+		/// type a component is passed as to foreach functions
+		template<typename t_component>
+		using foreach_argument = std::conditional_t<std::is_pointer_v<t_component>, t_component, t_component &>;
+		
+		template<typename ...t_components>
+		static constexpr det::type_list<foreach_argument<t_components>...> foreach_arguments_of(det::type_list<t_components...>) noexcept
+		{
+			return {};
+		}
+		
+		/// type of the span a component column is passed as to chunk functions
+		template<typename t_component>
+		using column_span = std::span<std::remove_pointer_t<std::remove_reference_t<t_component>>>;
+		
+		template<typename t_filter, typename t_function, typename ...t_components>
+		void apply_chunk_function_to_archetype(const typename query_cache<t_filter>::matched_archetype &matched, det::change_tick last_run_tick,
+		                                       det::change_tick write_tick, t_function &function, det::type_list<t_components...> type_list)
+		{
+			static_assert(std::is_invocable_v<t_function, std::span<const entity>, column_span<t_components>...>,
+			              "Types of function does not match with the ones of the query. Are you missing the std::span<const arch::entity> as the first parameter?");
+			
+			det::archetype_internal &internal = _archetypes[matched.archetype_index].internal();
+			const std::size_t n_chunks = internal.chunk_count();
+			for (std::size_t chunk_index = 0; chunk_index < n_chunks; ++chunk_index)
+			{
+				if (not chunk_passes_change_filter<t_filter>(internal, chunk_index, matched.changed_column_indices, last_run_tick))
+				{
+					continue;
+				}
+				
+				mark_written_columns<t_function>(internal, chunk_index, matched.column_indices, type_list, det::type_list<column_span<t_components>...>(),
+				                                 write_tick);
+				apply_chunk_function_to_chunk(function, internal, chunk_index, matched.column_indices, type_list,
+				                              std::make_index_sequence<sizeof...(t_components)>());
+			}
+		}
+		
+		template<typename t_function, std::size_t ...is, typename ...t_components>
+		static void apply_chunk_function_to_chunk(t_function &function, det::archetype_internal &current_archetype, std::size_t chunk_index,
+		                                          [[maybe_unused]] std::span<const std::size_t, sizeof...(t_components)> column_indices,
+		                                          det::type_list<t_components...>, std::integer_sequence<std::size_t, is...>)
+		{
+			// function parameters are unsorted but columns are sorted by type_id, so we need to map the indices
+			[[maybe_unused]] constexpr std::array parameter_indices = map_type_indices({id_of<t_components>()...}, ids_of<t_components...>());
+			
+			std::span<const entity> entities = current_archetype.chunk_entities(chunk_index);
+			function(entities, get_column_span<t_components>(current_archetype, chunk_index, column_indices[parameter_indices[is]], entities.size())...);
+		}
+		
+		template<typename t_component>
+		static column_span<t_component> get_column_span(det::archetype_internal &current_archetype, std::size_t chunk_index, std::size_t column_index,
+		                                                std::size_t chunk_size)
+		{
+			using element = typename column_span<t_component>::element_type;
+			if constexpr (std::is_pointer_v<t_component>)
+			{
+				// optional component
+				if (column_index == det::archetype_internal::no_column)
+				{
+					return {};
+				}
+			}
+			
+			return {reinterpret_cast<element *>(current_archetype.chunk_column_data(chunk_index, column_index)), chunk_size};
+		}
+		
+		template<typename t_function, typename ...t_components>
+		static void apply_foreach_function_to_chunk(t_function &function, archetype &current_archetype, std::size_t chunk_index,
+		                                            std::size_t first_in_chunk_index, std::size_t end_in_chunk_index,
+		                                            std::span<const std::size_t, sizeof...(t_components)> column_indices,
+		                                            det::type_list<t_components...> type_list)
+		{
+			det::archetype_internal &internal = current_archetype.internal();
+			
+			std::array<std::byte *, sizeof...(t_components)> columns;
+			for (std::size_t i = 0; i < columns.size(); ++i)
+			{
+				columns[i] = column_indices[i] == det::archetype_internal::no_column ? nullptr : internal.chunk_column_data(chunk_index, column_indices[i]);
+			}
+			
+			std::span<const entity> entities = internal.chunk_entities(chunk_index);
+			arch_assert_internal(end_in_chunk_index <= entities.size());
+			for (std::size_t i = first_in_chunk_index; i < end_in_chunk_index; ++i)
+			{
+				apply_foreach_function_to_entity(function, i, entities, columns, type_list, std::make_index_sequence<sizeof...(t_components)>());
+			}
+		}
+		
+		template<std::size_t array_size>
+		[[nodiscard]]
+		static consteval std::array<std::size_t, array_size> map_type_indices(std::array<type_id, array_size> from, std::array<type_id, array_size> to)
+		{
+			std::array<std::size_t, array_size> mapped_indices{};
+			
+			for (std::size_t i = 0; i < array_size; ++i)
+			{
+				auto found = std::find(to.begin(), to.end(), from[i]);
+				
+				if (found == to.end())
+				{
+					throw std::exception();
+				}
+				else
+				{
+					std::size_t to_index = found - to.begin();
 					mapped_indices[i] = to_index;
 				}
 			}
@@ -555,100 +1302,238 @@ namespace arch
 		}
 		
 		template<typename t_function, std::size_t ...is, typename ...t_components>
-		static void apply_foreach_function_to_entity(t_function &function, std::size_t in_archetype_index,
-		                                             std::span<const entity> entities, std::span<det::rtt_vector *> component_vectors,
+		static void apply_foreach_function_to_entity(t_function &function, std::size_t in_chunk_index,
+		                                             std::span<const entity> entities, std::span<std::byte *const, sizeof...(t_components)> columns,
 		                                             det::type_list<t_components...>, std::integer_sequence<std::size_t, is...>)
 		{
-			// function parameters are unsorted but component_vectors are sorted by type_id, so we need to map the indices
-			constexpr std::array parameter_indices = map_type_indices(ids_of<t_components...>(), {id_of<t_components>()...});
-			function(entities[in_archetype_index], get_from_vector_or_null<t_components>(component_vectors[parameter_indices[is]], in_archetype_index)...);
+			// function parameters are unsorted but columns are sorted by type_id, so we need to map the indices
+			constexpr std::array parameter_indices = map_type_indices({id_of<t_components>()...}, ids_of<t_components...>());
+			function(entities[in_chunk_index], get_from_column_or_null<t_components>(columns[parameter_indices[is]], in_chunk_index)...);
 		}
 		
 		template<typename t_component>
-		static std::conditional_t<std::is_pointer_v<t_component>, t_component, t_component &>
-		get_from_vector_or_null(det::rtt_vector *arch_restrict component_vector, std::size_t in_vector_index)
+		static foreach_argument<t_component> get_from_column_or_null(std::byte *arch_restrict column, std::size_t in_chunk_index)
 		{
 			if constexpr (std::is_pointer_v<t_component>)
 			{
-				// optional component, expect component_vector to be null
-				if (component_vector == nullptr)
+				// optional component, expect column to be null
+				if (column == nullptr)
 				{
 					return nullptr;
 				}
 				else
 				{
-					return reinterpret_cast<t_component>((*component_vector)[in_vector_index]);
+					return reinterpret_cast<t_component>(column) + in_chunk_index;
 				}
 			}
 			else
 			{
 				// guaranteed component access
-				return *reinterpret_cast<std::remove_reference_t<t_component> *>((*component_vector)[in_vector_index]);
+				return reinterpret_cast<std::remove_reference_t<t_component> *>(column)[in_chunk_index];
 			}
 		}
 		
-		template<typename t_filter, typename t_function, typename ...t_components>
-		static void
-		apply_foreach_function_parallel(t_function &function, t_filter, det::type_list<t_components...> type_list, archetype &current_archetype,
-		                                std::size_t thread_id)
+		template<typename t_function, typename ...t_components>
+		static void apply_foreach_function_parallel(t_function &function, det::type_list<t_components...> type_list, archetype &current_archetype,
+		                                            std::span<const std::size_t, sizeof...(t_components)> column_indices, std::size_t chunk_index,
+		                                            std::size_t first_in_chunk_index, std::size_t end_in_chunk_index)
 		{
 			//NOTE: should we leave this here so that user don't have to write & in queries?
 			static_assert(std::is_invocable_v<t_function, entity, t_components...> || std::is_invocable_v<t_function, entity, t_components &...>,
 			              "Types of function does not match with the ones of the query");
 			
-			constexpr std::array wanted_types = ids_of<t_components...>();
-			auto contained_types = current_archetype.get_contained_types();
+			apply_foreach_function_to_chunk(function, current_archetype, chunk_index, first_in_chunk_index, end_in_chunk_index, column_indices, type_list);
+		}
+		
+		/// copy constructs value into the entities [first_in_chunk_index, first_in_chunk_index + n_entities) of a column inside a chunk
+		template<typename t_component>
+		static void fill_column(det::archetype_internal &target_archetype, std::size_t chunk_index, std::size_t column_index,
+		                        std::size_t first_in_chunk_index, std::size_t n_entities, const t_component &value)
+		{
+			auto *column = reinterpret_cast<t_component *>(target_archetype.chunk_column_data(chunk_index, column_index));
+			std::uninitialized_fill_n(column + first_in_chunk_index, n_entities, value);
+		}
+		
+		/// creates count entities inside the archetype with the given index, reusing dead entity ids first. leaves their components uninitialized
+		std::span<const entity> create_entities_in(std::size_t archetype_index, std::size_t count)
+		{
+			if (count == 0)
+			{
+				_created_entities.clear();
+				return {};
+			}
 			
-			std::array<det::rtt_vector *, sizeof...(t_components)> component_vectors;
+			allocate_entity_ids(count);
+			const std::size_t first_in_archetype_index = _archetypes[archetype_index].internal().add_entities(_created_entities);
+			for (std::size_t i = 0; i < count; ++i)
 			{
-				std::span<det::rtt_vector> archetype_component_vectors = current_archetype.internal().component_vectors();
-				std::size_t vectors_index = 0;
-				for (std::size_t wanted_types_index = 0; wanted_types_index < wanted_types.size(); ++wanted_types_index)
-				{
-					// search for next type
-					while (contained_types[vectors_index] < wanted_types[wanted_types_index])
-					{
-						++vectors_index;
-					}
-					
-					if (contained_types[vectors_index] != wanted_types[wanted_types_index])
-					{
-						// optional type was not found
-						component_vectors[wanted_types_index] = nullptr;
-					}
-					else
-					{
-						component_vectors[wanted_types_index] = &archetype_component_vectors[vectors_index];
-						++vectors_index;
-					}
-				}
+				entity created = _created_entities[i];
+				_entities[created.id] = {created.version, static_cast<std::uint32_t>(archetype_index),
+				                         static_cast<std::uint32_t>(first_in_archetype_index + i)};
+				mark_info_changed(created.id);
 			}
 			
-			constexpr std::size_t thread_stride = 64;
+			if (has_observers()) [[unlikely]]
+			{
+				record_component_set_change(_created_entities, {}, _archetypes[archetype_index].get_component_mask());
+			}
+			
+			return {_created_entities};
+		}
+		
+		/// fills _created_entities with count unused entity ids, reusing dead entity ids first. the caller has to place them into an archetype
+		void allocate_entity_ids(std::size_t count)
+		{
+			_created_entities.resize(count);
 			
-			std::span<const entity> entities = current_archetype.entities();
-			const std::size_t archetype_size = current_archetype.size();
-			for (std::size_t iteration_begin = thread_id * thread_stride; iteration_begin < archetype_size; iteration_begin += thread_stride)
+			std::size_t n_reused = 0;
+			while (n_reused < count && _first_dead_entity != NO_DEAD_ENTITY)
 			{
-				const std::size_t iteration_end = iteration_begin + thread_stride;
-				for (std::size_t current_index = iteration_begin; current_index < iteration_end; ++current_index)
-				{
-					apply_foreach_function_to_entity(function, current_index, entities, component_vectors,
-					                                 type_list, std::make_index_sequence<sizeof...(t_components)>());
-				}
+				const entity_info &reused_info = _entities[_first_dead_entity];
+				_created_entities[n_reused] = {_first_dead_entity, reused_info.version};
+				_first_dead_entity = reused_info.in_archetype_index;
+				++n_reused;
+			}
+			
+			const std::size_t first_new_id = _entities.size();
+			for (std::size_t i = n_reused; i < count; ++i)
+			{
+				_created_entities[i] = {static_cast<entity_id_t>(first_new_id + (i - n_reused)), 0};
 			}
+			_entities.resize(first_new_id + (count - n_reused));
+			add_entity_pages();
 		}
 		
-		void move_entity_to(entity target_entity, size_t previous_archetype_index, archetype &target_archetype)
+		void move_entity_to(entity target_entity, const det::archetype_transition &transition)
 		{
 			entity_info &info = get_info(target_entity);
-			std::size_t previous_in_archetype_index = info.in_archetype_index;
-			det::archetype_internal &previous_archetype = _archetypes[previous_archetype_index].internal();
-			auto [next_in_archetype_index, swapped_entity] = target_archetype.internal().move_entity_over_from(target_entity,
-			                                                                                                   previous_archetype,
-			                                                                                                   previous_in_archetype_index);
+			if (info.owning_archetype_index == transition.target_archetype_index)
+			{
+				return;
+			}
+			
+			std::uint32_t previous_in_archetype_index = info.in_archetype_index;
+			det::archetype_internal &previous_archetype = _archetypes[info.owning_archetype_index].internal();
+			det::archetype_internal &target_archetype = _archetypes[transition.target_archetype_index].internal();
+			auto [next_in_archetype_index, swapped_entity] = target_archetype.move_entity_over_from(target_entity,
+			                                                                                        previous_archetype,
+			                                                                                        previous_in_archetype_index,
+			                                                                                        transition);
 			get_info(swapped_entity).in_archetype_index = previous_in_archetype_index;
-			info.in_archetype_index = next_in_archetype_index;
+			info.owning_archetype_index = static_cast<std::uint32_t>(transition.target_archetype_index);
+			info.in_archetype_index = static_cast<std::uint32_t>(next_in_archetype_index);
+			mark_info_changed(swapped_entity.id);
+			mark_info_changed(target_entity.id);
+			
+			if (has_observers()) [[unlikely]]
+			{
+				record_component_set_change({&target_entity, 1}, previous_archetype.get_component_mask(), target_archetype.get_component_mask());
+			}
+		}
+		
+		/// remembers that the entity_info of the entity with the given id changed, so that delta snapshots contain its page
+		void mark_info_changed(entity_id_t id)
+		{
+			_entity_page_ticks[id / ENTITY_PAGE_SIZE] = get_change_tick();
+		}
+		
+		/// gives every page of _entities a change tick, new pages count as changed
+		void add_entity_pages()
+		{
+			_entity_page_ticks.resize((_entities.size() + ENTITY_PAGE_SIZE - 1) / ENTITY_PAGE_SIZE, get_change_tick());
+		}
+		
+		/// Moves entities that all live inside the archetype with the given index into the target archetype of transition at once
+		/// \param moved gets sorted by the position of the entities inside their current archetype
+		void move_entities_to(std::span<entity> moved, std::size_t source_archetype_index, const det::archetype_transition &transition)
+		{
+			if (moved.empty() || source_archetype_index == transition.target_archetype_index)
+			{
+				return;
+			}
+			
+			std::sort(moved.begin(), moved.end(), [this](entity lhs, entity rhs)
+			{
+				return _entities[lhs.id].in_archetype_index < _entities[rhs.id].in_archetype_index;
+			});
+			
+			_moved_indices.clear();
+			for (entity moved_entity: moved)
+			{
+				arch_assert_internal(_entities[moved_entity.id].owning_archetype_index == source_archetype_index);
+				_moved_indices.push_back(_entities[moved_entity.id].in_archetype_index);
+			}
+			
+			det::archetype_internal &source_archetype = _archetypes[source_archetype_index].internal();
+			det::archetype_internal &target_archetype = _archetypes[transition.target_archetype_index].internal();
+			auto update_swapped = [this](entity swapped_entity, std::size_t new_index)
+			{
+				_entities[swapped_entity.id].in_archetype_index = static_cast<std::uint32_t>(new_index);
+				mark_info_changed(swapped_entity.id);
+			};
+			const std::size_t first_in_archetype_index = target_archetype.move_entities_over_from(moved, source_archetype, _moved_indices, transition,
+			                                                                                      update_swapped);
+			
+			for (std::size_t i = 0; i < moved.size(); ++i)
+			{
+				entity_info &info = _entities[moved[i].id];
+				info.owning_archetype_index = static_cast<std::uint32_t>(transition.target_archetype_index);
+				info.in_archetype_index = static_cast<std::uint32_t>(first_in_archetype_index + i);
+				mark_info_changed(moved[i].id);
+			}
+			
+			if (has_observers()) [[unlikely]]
+			{
+				record_component_set_change(moved, source_archetype.get_component_mask(), target_archetype.get_component_mask());
+			}
+		}
+		
+		/// \return the transition from one archetype into another, calculated on first use and cached inside the source archetype afterwards
+		const det::archetype_transition &get_transition(std::size_t source_archetype_index, std::size_t target_archetype_index)
+		{
+			const det::archetype_transition *transition = _archetypes[source_archetype_index].internal().find_transition_to(target_archetype_index);
+			if (transition == nullptr) [[unlikely]]
+			{
+				transition = &_archetypes[source_archetype_index].internal().cache_transition_to(_archetypes[target_archetype_index].internal(),
+				                                                                                 target_archetype_index);
+			}
+			return *transition;
+		}
+		
+		/// \return the index of the archetype containing the types of the given archetype plus to_add and without to_remove. Creates that
+		/// archetype if it does not exist yet
+		std::size_t get_or_create_archetype_index(std::size_t previous_archetype_index, std::span<const type_info> to_add,
+		                                          std::span<const det::multi_destructor> added_destructors, std::span<const type_id> to_remove)
+		{
+			// collect the exact set of types the archetype needs to have
+			std::span<const type_id> previous_types = _archetypes[previous_archetype_index].get_contained_types();
+			_types_buffer.assign(previous_types.begin(), previous_types.end());
+			for (type_info added: to_add)
+			{
+				auto position = std::lower_bound(_types_buffer.begin(), _types_buffer.end(), added.id);
+				if (position == _types_buffer.end() || *position != added.id)
+				{
+					_types_buffer.insert(position, added.id);
+				}
+			}
+			for (type_id removed: to_remove)
+			{
+				auto position = std::lower_bound(_types_buffer.begin(), _types_buffer.end(), removed);
+				if (position != _types_buffer.end() && *position == removed)
+				{
+					_types_buffer.erase(position);
+				}
+			}
+			
+			const std::uint64_t signature = det::hashing::signature_of(_types_buffer);
+			std::size_t found_index = _archetype_index.find(signature, _types_buffer, _archetypes);
+			if (found_index != det::archetype_index::no_archetype)
+			{
+				return found_index;
+			}
+			
+			create_archetype_from_base_with(previous_archetype_index, to_add, added_destructors, to_remove);
+			return _archetypes.size() - 1;
 		}
 		
 		/// Gets the archetype that contains no components
@@ -658,16 +1543,16 @@ namespace arch
 			return _archetypes[BASE_ARCHETYPE_INDEX];
 		}
 		
-		archetype *get_archetype_with(std::span<type_id> types)
+		/// \param types in ascending order
+		/// \return the archetype containing exactly the given types or nullptr if there is none
+		archetype *get_archetype_with(std::span<const type_id> types)
 		{
-			std::uint32_t combined_hash = det::hashing::combine_hashes(types);
-			
-			auto result = _types_to_archetype.find(combined_hash);
-			if (result == _types_to_archetype.end())
+			std::size_t found_index = _archetype_index.find(det::hashing::signature_of(types), types, _archetypes);
+			if (found_index == det::archetype_index::no_archetype)
 			{
 				return nullptr;
 			}
-			return &_archetypes[result->second];
+			return &_archetypes[found_index];
 		}
 		
 		/// Creates an archetype that contains the types of source_archetype except the ones listed in to_remove
@@ -675,6 +1560,13 @@ namespace arch
 		                                           std::span<const det::multi_destructor> added_destructors, std::span<const type_id> to_remove)
 		{
 			arch_assert_internal(to_add.size() == added_destructors.size());
+			arch_assert_external(_archetypes.size() < DEAD_ARCHETYPE_INDEX);
+			
+			// registering the added types may throw std::length_error, which has to happen before the world gets changed
+			for (type_info added: to_add)
+			{
+				(void) det::component_registry::index_of(added.id);
+			}
 			
 			std::size_t created_archetype_index = _archetypes.size();
 			archetype &created = _archetypes.emplace_back();
@@ -694,9 +1586,32 @@ namespace arch
 					modifer.remove_type(remove_type);
 				}
 			}
-			// TODO: This might return the same archetype, how do we deal with this?
-			// We should check this earlier, before creating a new archetype
-			_types_to_archetype[created.internal().get_combined_types_hash()] = created_archetype_index;
+			created.internal().set_change_tick_source(&_change_tick);
+			created.internal().set_chunk_resource(_chunk_memory.get());
+			std::span<const type_id> created_types = created.get_contained_types();
+			arch_assert_internal(_archetype_index.find(det::hashing::signature_of(created_types), created_types, _archetypes) == det::archetype_index::no_archetype);
+			_archetype_index.insert(det::hashing::signature_of(created_types), created_archetype_index);
+			notify_archetype_created(created_archetype_index);
+			
+			return created;
+		}
+		
+		/// Creates an archetype with the same types and layout as an archetype of another world
+		archetype &create_archetype_like(const det::archetype_internal &other_archetype)
+		{
+			arch_assert_external(_archetypes.size() < DEAD_ARCHETYPE_INDEX);
+			
+			std::size_t created_archetype_index = _archetypes.size();
+			archetype &created = _archetypes.emplace_back();
+			{
+				auto modifer = created.internal().modify_archetype();
+				modifer.copy_settings_from(other_archetype, _archetype_memory);
+			}
+			created.internal().set_change_tick_source(&_change_tick);
+			created.internal().set_chunk_resource(_chunk_memory.get());
+			std::span<const type_id> created_types = created.get_contained_types();
+			_archetype_index.insert(det::hashing::signature_of(created_types), created_archetype_index);
+			notify_archetype_created(created_archetype_index);
 			
 			return created;
 		}
@@ -705,29 +1620,174 @@ namespace arch
 		template<typename ...t_components>
 		archetype &create_archetype_with_types()
 		{
+			// building the mask may throw std::length_error, which has to happen before the world gets changed
+			(void) det::mask_of<t_components...>();
+			
 			std::size_t created_archetype_index = _archetypes.size();
 			archetype &created = _archetypes.emplace_back();
 			
 			{
 				auto modifer = created.internal().modify_archetype();
-				((modifer.add_type<t_components>(_archetype_memory)), ...);
+				modifer.init<t_components...>(_archetype_memory);
 			}
+			created.internal().set_change_tick_source(&_change_tick);
+			created.internal().set_chunk_resource(_chunk_memory.get());
 			
-			constexpr std::array archetype_hashes = ids_of<t_components...>();
-			constexpr std::uint32_t combined_types_hash = det::hashing::combine_hashes(archetype_hashes);
-			_types_to_archetype[combined_types_hash] = created_archetype_index;
+			constexpr std::array archetype_types = ids_of<t_components...>();
+			_archetype_index.insert(det::hashing::signature_of(archetype_types), created_archetype_index);
+			notify_archetype_created(created_archetype_index);
 			
 			return created;
 		}
+		
+		/// lets every query cache check if it matches the newly created archetype
+		void notify_archetype_created(std::size_t created_archetype_index)
+		{
+			for (auto &[filter_slot, cache]: _query_caches)
+			{
+				cache->on_archetype_created(_archetypes[created_archetype_index], created_archetype_index);
+			}
+		}
+		
+		struct fork_tag
+		{
+		};
+		
+		/// a state of all entities inside the rollback ring
+		struct captured_state
+		{
+			/// tick of the world at the time of the capture, 0 while nothing got captured into the state
+			det::change_tick tick = 0;
+			entity_id_t first_dead_entity = NO_DEAD_ENTITY;
+			std::vector<entity_info> entities{};
+			/// the chunks of every archetype, shared with the archetype until either gets written to
+			std::vector<std::vector<det::chunk>> archetype_chunks{};
+		};
+		
+		/// copies the pages whose change tick is newer than since from source into target, which contained all pages of source at that tick.
+		/// source may not contain more pages than the world
+		void copy_changed_entity_pages(const std::vector<entity_info> &source, std::vector<entity_info> &target, det::change_tick since) const
+		{
+			target.resize(source.size());
+			const std::size_t n_pages = (source.size() + ENTITY_PAGE_SIZE - 1) / ENTITY_PAGE_SIZE;
+			for (std::size_t page_index = 0; page_index < n_pages; ++page_index)
+			{
+				if (_entity_page_ticks[page_index] > since)
+				{
+					const std::size_t first = page_index * ENTITY_PAGE_SIZE;
+					std::copy(source.begin() + first, source.begin() + std::min(first + ENTITY_PAGE_SIZE, source.size()), target.begin() + first);
+				}
+			}
+		}
+		
+		/// lets go of the chunks of a captured state, the next capture into it copies all pages of the entity index
+		void release_captured_state(captured_state &state)
+		{
+			for (std::size_t i = 0; i < state.archetype_chunks.size(); ++i)
+			{
+				_archetypes[i].internal().release_chunks(state.archetype_chunks[i]);
+			}
+			state.tick = 0;
+		}
+		
+		world(world &source, fork_tag)
+				: _archetype_memory(POOL_OPTIONS, source._archetype_memory.upstream_resource()),
+				  _chunk_memory(source._chunk_memory),
+				  _merged_chunk_memory(source._merged_chunk_memory),
+				  _mapped_snapshots(source._mapped_snapshots),
+				  _entities(source._entities),
+				  _first_dead_entity(source._first_dead_entity),
+				  _entity_page_ticks(source._entity_page_ticks),
+				  _archetype_index(source._archetype_index),
+				  _change_tick(source.get_change_tick())
+		{
+			_archetypes.reserve(source._archetypes.size());
+			for (archetype &source_archetype: source._archetypes)
+			{
+				archetype &created = _archetypes.emplace_back();
+				{
+					auto modifer = created.internal().modify_archetype();
+					modifer.copy_settings_from(source_archetype.internal(), _archetype_memory);
+				}
+				created.internal().set_change_tick_source(&_change_tick);
+				created.internal().set_chunk_resource(source_archetype.internal().chunk_resource());
+				created.internal().share_chunks_of(source_archetype.internal());
+			}
+		}
 	
 	private:
-		static constexpr std::size_t BASE_ARCHETYPE_INDEX = 0;
+		static constexpr std::uint32_t BASE_ARCHETYPE_INDEX = 0;
+		/// archetype index of entity slots that are currently not in use
+		static constexpr std::uint32_t DEAD_ARCHETYPE_INDEX = std::numeric_limits<std::uint32_t>::max();
+		/// marks the end of the free list of dead entities
+		static constexpr entity_id_t NO_DEAD_ENTITY = std::numeric_limits<entity_id_t>::max();
+		/// smallest number of entities a task of for_all_parallel processes, keeps the per task overhead small compared to its work
+		static constexpr std::size_t MIN_PARALLEL_GRAIN_SIZE = 64;
+		/// number of tasks for_all_parallel creates per thread of the pool if there are enough entities
+		static constexpr std::size_t PARALLEL_TASKS_PER_THREAD = 8;
+		/// number of entity_infos that share a change tick, see mark_info_changed
+		static constexpr std::size_t ENTITY_PAGE_SIZE = 1024;
+		/// blocks up to the size of a chunk get pooled, larger ones come directly from the upstream resource
+		static constexpr std::pmr::pool_options POOL_OPTIONS{0, det::default_chunk_size};
 		
-		std::pmr::unsynchronized_pool_resource _archetype_memory{{0, 4096}};
+		std::pmr::unsynchronized_pool_resource _archetype_memory;
+		/// memory of all chunks unless set_chunk_resource got used. forks share it, since a chunk gets deallocated by the last world using it
+		std::shared_ptr<std::pmr::synchronized_pool_resource> _chunk_memory;
+		/// memory of other worlds whose chunks got taken over by merge_from
+		std::vector<std::shared_ptr<std::pmr::synchronized_pool_resource>> _merged_chunk_memory{};
+		
+		/// files loaded by world_snapshot, archetypes use their memory as chunks. declared before _archetypes so that they outlive them
+		std::vector<std::shared_ptr<det::mapped_file>> _mapped_snapshots{};
 		
 		std::vector<entity_info> _entities{};
-		std::vector<entity> _dead_entities{};
+		/// head of the free list threaded through the slots of dead entities
+		entity_id_t _first_dead_entity = NO_DEAD_ENTITY;
+		/// tick at which an entity_info of each page of ENTITY_PAGE_SIZE entities last changed, used by delta snapshots
+		std::vector<det::change_tick> _entity_page_ticks{};
 		std::vector<archetype> _archetypes{};
-		std::unordered_map<std::uint32_t, std::size_t> _types_to_archetype{};
+		det::archetype_index _archetype_index{};
+		/// temporary storage for sorted type sets, used when searching archetypes
+		std::vector<type_id> _types_buffer{};
+		/// entities returned by the last call to create_entities
+		std::vector<entity> _created_entities{};
+		/// stored into the change ticks of written columns, see changed_q. queries of systems running at the same time advance it concurrently
+		std::atomic<det::change_tick> _change_tick = 1;
+		/// positions of the entities inside their archetype, used by move_entities_to
+		std::vector<std::size_t> _moved_indices{};
+		/// caches of all queries used on this world so far, keyed by the filter_slot_of their filter
+		std::unordered_map<std::size_t, std::unique_ptr<det::query_cache_base>> _query_caches{};
+		/// lets systems running at the same time look up and create query caches
+		std::mutex _query_caches_mutex{};
+		
+		/// a range of rows inside a chunk of a matched archetype, processed by one task of for_all_parallel
+		struct parallel_task
+		{
+			std::size_t matched_index;
+			std::size_t chunk_index;
+			std::size_t first_in_chunk_index;
+			std::size_t end_in_chunk_index;
+		};
+		
+		/// observers of component types, each component type has at most one entry
+		std::vector<observed_component> _observed_components{};
+		std::vector<observer_function> _destroy_observers{};
+		/// destroyed entities not yet delivered to the destroy observers
+		std::vector<entity> _destroyed_entities{};
+		/// the batch of events currently handed to observers
+		std::vector<entity> _delivered_entities{};
+		bool _delivering_observer_events = false;
+		/// observers registered by observers during the current delivery
+		std::vector<pending_observer> _pending_observers{};
+		/// ring of states rollback can return to, see capture_state
+		std::vector<captured_state> _captured_states{};
+		std::size_t _newest_captured_state = 0;
+		std::size_t _n_captured_states = 0;
+		/// tick of the last rollback, delta snapshots can not be based on earlier snapshots and change trackers that ran earlier see everything
+		det::change_tick _last_rollback_tick = 0;
+		std::unique_ptr<thread_pool> _owned_thread_pool{};
+		thread_pool *_thread_pool = nullptr;
+		
+		friend class entity_command_buffer;
+		friend class world_snapshot;
 	};
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "doctest.h"
 
 #include <archecs/archetype.hpp>
+#include <archecs/internal/archetype_index.hpp>
 
 namespace
 {
@@ -27,4 +28,48 @@ namespace
 		CHECK(test_arch.contains_type(id_of<t2>()));
 		CHECK(test_arch.contains_type(id_of<t3>()));
 	}
-}
\ No newline at end of file
+	
+	struct type_set
+	{
+		std::vector<arch::type_id> types;
+		
+		[[nodiscard]]
+		std::span<const arch::type_id> get_contained_types() const
+		{
+			return types;
+		}
+	};
+	
+	TEST_CASE("archetype index lookup")
+	{
+		constexpr std::array t1_t2 = arch::ids_of<t1, t2>();
+		constexpr std::array t3_only = arch::ids_of<t3>();
+		std::vector<type_set> archetypes(3);
+		archetypes[1].types.assign(t1_t2.begin(), t1_t2.end());
+		archetypes[2].types.assign(t3_only.begin(), t3_only.end());
+		arch::det::archetype_index index{};
+		// force every set onto the same signature to check that the full sets get compared
+		for (std::size_t i = 0; i < archetypes.size(); ++i)
+		{
+			index.insert(42, i);
+		}
+		
+		CHECK_EQ(index.find(42, archetypes[0].types, archetypes), 0);
+		CHECK_EQ(index.find(42, archetypes[1].types, archetypes), 1);
+		CHECK_EQ(index.find(42, archetypes[2].types, archetypes), 2);
+		CHECK_EQ(index.find(7, archetypes[2].types, archetypes), arch::det::archetype_index::no_archetype);
+		
+		constexpr std::array t1_t3 = arch::ids_of<t1, t3>();
+		CHECK_EQ(index.find(42, t1_t3, archetypes), arch::det::archetype_index::no_archetype);
+	}
+	
+	TEST_CASE("archetype signature")
+	{
+		constexpr std::array t1_t2 = arch::ids_of<t1, t2>();
+		constexpr std::array t2_t1 = {id_of<t2>(), id_of<t1>()};
+		constexpr std::array t3_only = arch::ids_of<t3>();
+		static_assert(arch::det::hashing::signature_of(t1_t2) == arch::det::hashing::signature_of(t2_t1));
+		CHECK_NE(arch::det::hashing::signature_of(t1_t2), arch::det::hashing::signature_of(t3_only));
+		CHECK_NE(arch::det::hashing::signature_of(t1_t2), arch::det::hashing::signature_of({}));
+	}
+}
@@ -1,5 +1,10 @@
 #include "doctest.h"
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include <archecs/world.hpp>
 #include <archecs/command_buffer.hpp>
 #include <archecs/queries.hpp>
@@ -25,6 +30,7 @@ namespace command_buffer_test
 	using arch::world;
 	using arch::entity;
 	using arch::virtual_entity;
+	using arch::entity_id_t;
 	using arch::entity_command_buffer;
 	
 	TEST_CASE("command buffer add component")
@@ -96,6 +102,42 @@ namespace command_buffer_test
 		CHECK_EQ(test_world.get_component<t2>(created1).data, 0);
 	}
 	
+	struct shared_value
+	{
+		std::shared_ptr<int> value = std::make_shared<int>(3);
+	};
+	
+	TEST_CASE("command buffer target dies before playback")
+	{
+		world test_world{};
+		entity target = test_world.create_entity();
+		test_world.add_components(target, t1{}, t2{256});
+		shared_value recorded{};
+		
+		entity_command_buffer destroying{test_world};
+		destroying.destroy_entity(target);
+		entity_command_buffer modifying{test_world};
+		modifying.add_component(target, t3{});
+		modifying.add_component(target, shared_value{recorded});
+		modifying.set_component(target, t1{5});
+		modifying.remove_component<t2>(target);
+		destroying.run();
+		
+		// the slot of the dead entity gets reused by another one, which the commands may not reach either
+		entity reused = test_world.create_entity();
+		test_world.add_components(reused, t1{7}, t2{9});
+		REQUIRE_EQ(reused.id, target.id);
+		REQUIRE_EQ(recorded.value.use_count(), 2);
+		modifying.run();
+		
+		CHECK_FALSE(test_world.is_alive(target));
+		CHECK_EQ(test_world.get_component<t1>(reused).data, 7);
+		CHECK_EQ(test_world.get_component<t2>(reused).data, 9);
+		CHECK_FALSE(test_world.has_component<t3>(reused));
+		// the recorded value got destroyed without being added anywhere
+		CHECK_EQ(recorded.value.use_count(), 1);
+	}
+	
 	TEST_CASE("command buffer optimized add")
 	{
 		world test_world{};
@@ -160,4 +202,193 @@ namespace command_buffer_test
 		CHECK_EQ(t2_count, 1);
 		CHECK_EQ(t3_count, 2);
 	}
+	
+	/// owns heap memory, so that a missing or doubled destruction shows up in sanitized builds
+	struct owning
+	{
+		std::vector<int> values;
+	};
+	
+	TEST_CASE("command buffer bulk playback")
+	{
+		world test_world{};
+		std::vector<entity> entities{};
+		for (int i = 0; i < 5000; ++i)
+		{
+			entity created = test_world.create_entity();
+			test_world.add_components(created, t1{i});
+			entities.push_back(created);
+		}
+		
+		{
+			entity_command_buffer ecb{test_world};
+			for (int i = 0; i < 5000; ++i)
+			{
+				const entity current = entities[i];
+				if (i % 2 == 0)
+				{
+					ecb.add_component(current, owning{{i, i}});
+				}
+				if (i % 3 == 0)
+				{
+					ecb.remove_component<t1>(current);
+				}
+				else if (i % 5 == 0)
+				{
+					ecb.set_component(current, t1{-i});
+				}
+				if (i % 7 == 0)
+				{
+					// replaces the value recorded before
+					ecb.add_component(current, owning{{-i}});
+				}
+				if (i % 11 == 0)
+				{
+					ecb.destroy_entity(current);
+				}
+			}
+			
+			virtual_entity created = ecb.create_entity();
+			ecb.add_component(created, owning{{1, 2, 3}});
+			ecb.destroy_entity(ecb.create_entity());
+			ecb.run();
+		}
+		
+		std::size_t n_created = 0;
+		test_world.for_all(arch::with<owning>, [&](entity current, const owning &component)
+		{
+			if (component.values == std::vector{1, 2, 3})
+			{
+				CHECK_FALSE(test_world.has_component<t1>(current));
+				++n_created;
+			}
+		});
+		CHECK_EQ(n_created, 1);
+		
+		for (int i = 0; i < 5000; ++i)
+		{
+			const entity current = entities[i];
+			if (i % 11 == 0)
+			{
+				CHECK_FALSE(test_world.is_alive(current));
+				continue;
+			}
+			
+			REQUIRE(test_world.is_alive(current));
+			CHECK_EQ(test_world.has_component<t1>(current), i % 3 != 0);
+			if (i % 3 != 0)
+			{
+				CHECK_EQ(test_world.get_component<t1>(current).data, i % 5 == 0 ? -i : i);
+			}
+			
+			CHECK_EQ(test_world.has_component<owning>(current), i % 2 == 0 || i % 7 == 0);
+			if (i % 7 == 0)
+			{
+				CHECK(test_world.get_component<owning>(current).values == std::vector{-i});
+			}
+			else if (i % 2 == 0)
+			{
+				CHECK(test_world.get_component<owning>(current).values == std::vector{i, i});
+			}
+		}
+	}
+	
+	TEST_CASE("command buffer reuse")
+	{
+		world test_world{};
+		test_world.create_entities(100, t1{});
+		std::vector<entity> entities{};
+		test_world.for_all(arch::with<t1>, [&](entity current, auto)
+		{
+			entities.push_back(current);
+		});
+		
+		entity_command_buffer ecb{test_world, 0};
+		auto record = [&](int value)
+		{
+			for (entity current: entities)
+			{
+				ecb.add_component(current, owning{{value}});
+				ecb.set_component(current, t1{value});
+			}
+		};
+		
+		record(1);
+		const std::size_t reserved_bytes = ecb.reserved_bytes();
+		CHECK_GT(reserved_bytes, 0);
+		// dropped commands destroy their values and leave the world untouched
+		ecb.reset();
+		CHECK_EQ(ecb.reserved_bytes(), reserved_bytes);
+		for (entity current: entities)
+		{
+			CHECK_FALSE(test_world.has_component<owning>(current));
+		}
+		
+		for (int frame = 2; frame < 5; ++frame)
+		{
+			record(frame);
+			ecb.run();
+			CHECK_EQ(ecb.reserved_bytes(), reserved_bytes);
+			for (entity current: entities)
+			{
+				CHECK_EQ(test_world.get_component<t1>(current).data, frame);
+				CHECK(test_world.get_component<owning>(current).values == std::vector{frame});
+			}
+		}
+	}
+	
+	/// records commands from a parallel query and returns the id of the entity created for every source entity
+	std::vector<std::pair<int, entity_id_t>> record_in_parallel(arch::thread_pool &pool)
+	{
+		world test_world{};
+		test_world.set_thread_pool(pool);
+		test_world.create_entities(3000, t1{});
+		
+		arch::parallel_entity_command_buffer ecb{test_world};
+		test_world.for_all_parallel(arch::with<t1>, [&](entity current, t1 &)
+		{
+			entity_command_buffer &local = ecb.local();
+			local.set_sort_key(current.id);
+			if (current.id % 2 == 0)
+			{
+				local.add_component(current, t2{static_cast<int>(current.id)});
+			}
+			if (current.id % 100 == 0)
+			{
+				virtual_entity created = local.create_entity();
+				local.add_component(created, t3{static_cast<int>(current.id)});
+			}
+		});
+		ecb.run();
+		
+		std::size_t n_with_t2 = 0;
+		test_world.for_all(arch::with<t1, t2>, [&](entity current, const t1 &, const t2 &second)
+		{
+			CHECK_EQ(static_cast<entity_id_t>(second.data), current.id);
+			++n_with_t2;
+		});
+		CHECK_EQ(n_with_t2, 1500);
+		
+		std::vector<std::pair<int, entity_id_t>> created{};
+		test_world.for_all(arch::with<t3>, [&](entity current, const t3 &third)
+		{
+			created.emplace_back(third.data, current.id);
+		});
+		std::sort(created.begin(), created.end());
+		return created;
+	}
+	
+	TEST_CASE("parallel command buffer")
+	{
+		arch::thread_pool single_thread{0};
+		arch::thread_pool multiple_threads{3};
+		
+		auto single_threaded_result = record_in_parallel(single_thread);
+		CHECK_EQ(single_threaded_result.size(), 30);
+		for (int repetition = 0; repetition < 5; ++repetition)
+		{
+			// created entities get the same ids no matter which thread recorded them
+			CHECK_EQ(record_in_parallel(multiple_threads), single_threaded_result);
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "doctest.h"
+
+#include <stdexcept>
+#include <utility>
+
+#include <archecs/world.hpp>
+
+// built into its own executable with a small ARCH_MAX_COMPONENT_TYPES, since filling the component registry affects the whole process
+namespace component_cap_test
+{
+	template<std::size_t N>
+	struct numbered
+	{
+		std::size_t data = N;
+	};
+	
+	using arch::world;
+	using arch::entity;
+	
+	template<std::size_t ...t_numbers>
+	void add_numbered(world &target_world, entity target, std::index_sequence<t_numbers...>)
+	{
+		(target_world.add_component(target, numbered<t_numbers>{}), ...);
+	}
+	
+	TEST_CASE("world exceeding the component type cap")
+	{
+		world test_world{};
+		entity created = test_world.create_entity();
+		add_numbered(test_world, created, std::make_index_sequence<arch::det::max_component_types>{});
+		CHECK_EQ(test_world.get_component<numbered<3>>(created).data, 3);
+		
+		CHECK_THROWS_AS(test_world.add_component(created, numbered<arch::det::max_component_types>{}), std::length_error);
+		CHECK_THROWS_AS(test_world.create_entities(4, numbered<arch::det::max_component_types + 1>{}), std::length_error);
+		
+		// the world stays usable with the types registered before
+		CHECK(test_world.is_alive(created));
+		CHECK_FALSE(test_world.has_component<numbered<arch::det::max_component_types>>(created));
+		test_world.remove_components<numbered<0>>(created);
+		CHECK_EQ(test_world.get_component<numbered<1>>(created).data, 1);
+		CHECK_EQ(test_world.create_entities(4, numbered<2>{}).size(), 4);
+	}
+}
@@ -1,5 +1,12 @@
 #include "doctest.h"
 
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
 #include <archecs/system.hpp>
 #include <archecs/update_group.hpp>
 
@@ -118,4 +125,342 @@ namespace
 		CHECK_EQ(group_systems[2]->get_system_name(), "sys3"sv);
 		CHECK_EQ(group_systems[3]->get_system_name(), "sys4"sv);
 	}
-}
\ No newline at end of file
+	
+	/// appends its name to a shared log when executed
+	class logging_system : public arch::system_base
+	{
+	public:
+		logging_system(std::string_view name, std::vector<std::string_view> after, std::vector<std::string_view> &log, std::mutex &log_mutex)
+				: after_groups(std::move(after)), _log(log), _log_mutex(log_mutex)
+		{
+			system_name = name;
+		}
+		
+		std::span<const std::string_view> execute_after() const override
+		{
+			return after_groups;
+		}
+		
+		void execute(arch::world &) override
+		{
+			std::lock_guard lock(_log_mutex);
+			_log.push_back(system_name);
+		}
+		
+		std::vector<std::string_view> after_groups;
+	
+	private:
+		std::vector<std::string_view> &_log;
+		std::mutex &_log_mutex;
+	};
+	
+	TEST_CASE("update group parallel execution")
+	{
+		using namespace std::literals::string_view_literals;
+		
+		std::vector<std::string_view> log{};
+		std::mutex log_mutex{};
+		
+		arch::thread_pool pool{3};
+		arch::world test_world{};
+		test_world.set_thread_pool(pool);
+		
+		arch::update_group my_group{};
+		my_group.modify()
+		        .add_system<logging_system>("a"sv, std::vector<std::string_view>{}, log, log_mutex)
+		        .add_system<logging_system>("b"sv, std::vector{"a"sv}, log, log_mutex)
+		        .add_system<logging_system>("c"sv, std::vector{"a"sv}, log, log_mutex)
+		        .add_system<logging_system>("d"sv, std::vector{"b"sv, "c"sv}, log, log_mutex)
+		        .add_system<logging_system>("e"sv, std::vector<std::string_view>{}, log, log_mutex)
+		        .finish();
+		
+		for (int frame = 0; frame < 50; ++frame)
+		{
+			log.clear();
+			my_group.execute(test_world);
+			
+			REQUIRE_EQ(log.size(), 5);
+			auto position_of = [&](std::string_view name)
+			{
+				return std::find(log.begin(), log.end(), name) - log.begin();
+			};
+			CHECK_LT(position_of("a"sv), position_of("b"sv));
+			CHECK_LT(position_of("a"sv), position_of("c"sv));
+			CHECK_LT(position_of("b"sv), position_of("d"sv));
+			CHECK_LT(position_of("c"sv), position_of("d"sv));
+			CHECK_LT(position_of("e"sv), 5);
+		}
+		
+		// the systems do not declare their component access, so they run one after another even without named dependencies
+		auto nodes = my_group.get_system_graph().nodes();
+		CHECK_EQ(std::count_if(nodes.begin(), nodes.end(), [](const auto &node)
+		{
+			return node.previous_count == 0;
+		}), 1);
+	}
+	
+	/// runs a parallel loop on the thread pool of the world and remembers which threads took part
+	class parallel_loop_system : public arch::system_base
+	{
+	public:
+		parallel_loop_system()
+		{
+			system_name = "parallel loop";
+			accessed_components = arch::component_access::none();
+		}
+		
+		void execute(arch::world &execution_world) override
+		{
+			execution_world.get_thread_pool().run(64, [&](std::size_t, std::size_t thread_index)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				std::lock_guard lock(_threads_mutex);
+				used_threads.insert(thread_index);
+			});
+		}
+		
+		std::set<std::size_t> used_threads{};
+	
+	private:
+		std::mutex _threads_mutex{};
+	};
+	
+	TEST_CASE("update group nested parallel loops use waiting threads")
+	{
+		arch::thread_pool pool{3};
+		arch::world test_world{};
+		test_world.set_thread_pool(pool);
+		
+		arch::update_group my_group{};
+		my_group.modify().add_system<parallel_loop_system>().finish();
+		my_group.execute(test_world);
+		
+		const auto &system = static_cast<const parallel_loop_system &>(*my_group.get_contained_systems().front());
+		CHECK_GT(system.used_threads.size(), 1);
+	}
+	
+	struct position
+	{
+	};
+	struct velocity
+	{
+	};
+	
+	/// declares its component access in the constructor instead of naming other systems
+	class access_system : public arch::system_base
+	{
+	public:
+		access_system(std::string_view name, arch::component_access access)
+		{
+			system_name = name;
+			accessed_components = access;
+		}
+		
+		void execute(arch::world &) override
+		{}
+	};
+	
+	TEST_CASE("component access conflicts")
+	{
+		using arch::component_access;
+		
+		component_access moves = component_access::of<arch::entity, position &, const velocity &>();
+		CHECK(moves.get_writes().test(arch::det::component_index_of<position>()));
+		CHECK(moves.get_reads().test(arch::det::component_index_of<velocity>()));
+		CHECK_FALSE(moves.get_reads().test(arch::det::component_index_of<position>()));
+		
+		component_access reads_velocity = component_access::none().reads<velocity>();
+		component_access writes_velocity = component_access::none().writes<velocity>();
+		CHECK_FALSE(moves.conflicts_with(reads_velocity));
+		CHECK(moves.conflicts_with(writes_velocity));
+		CHECK(writes_velocity.conflicts_with(writes_velocity));
+		CHECK_FALSE(component_access::none().conflicts_with(moves));
+		// undeclared access conflicts with everything
+		CHECK(component_access{}.conflicts_with(component_access::none()));
+	}
+	
+	TEST_CASE("update group orders conflicting systems")
+	{
+		using namespace std::literals::string_view_literals;
+		using arch::component_access;
+		
+		arch::update_group my_group{};
+		my_group.modify()
+		        .add_system<access_system>("write position"sv, component_access::none().writes<position>())
+		        .add_system<access_system>("read position"sv, component_access::of<const position &>())
+		        .add_system<access_system>("write velocity"sv, component_access::none().writes<velocity>())
+		        .add_system<access_system>("read both"sv, component_access::none().reads<position, velocity>())
+		        .finish();
+		
+		auto nodes = my_group.get_system_graph().nodes();
+		REQUIRE_EQ(nodes.size(), 4);
+		auto node_of = [&](std::string_view name)
+		{
+			return *std::find_if(nodes.begin(), nodes.end(), [&](const auto &node)
+			{
+				return node.job->get_system_name() == name;
+			});
+		};
+		
+		CHECK_EQ(node_of("write position"sv).previous_count, 0);
+		CHECK_EQ(node_of("write velocity"sv).previous_count, 0);
+		CHECK_EQ(node_of("read position"sv).previous_count, 1);
+		// both readers may run at the same time
+		CHECK_EQ(node_of("read both"sv).previous_count, 2);
+	}
+	
+	struct counter_a
+	{
+		int value = 0;
+	};
+	struct counter_b
+	{
+		int value = 0;
+	};
+	
+	class counting_system : public arch::system_base
+	{
+	public:
+		std::size_t n_changed = 0;
+	};
+	
+	/// increments every component of type t_component in parallel, then counts the components changed since its last run
+	template<typename t_component>
+	class increment_system : public counting_system
+	{
+	public:
+		explicit increment_system(std::string_view name)
+		{
+			system_name = name;
+			accessed_components = arch::component_access::none().writes<t_component>();
+		}
+		
+		void execute(arch::world &execution_world) override
+		{
+			execution_world.for_all_parallel(arch::with<t_component>, [](arch::entity, t_component &component)
+			{
+				++component.value;
+			});
+			
+			n_changed = 0;
+			execution_world.for_all(arch::with<t_component> && arch::changed<t_component>, _tracker, [this](arch::entity, const t_component &)
+			{
+				++n_changed;
+			});
+		}
+	
+	private:
+		arch::change_tracker _tracker{};
+	};
+	
+	TEST_CASE("update group systems writing different components at the same time")
+	{
+		using namespace std::literals::string_view_literals;
+		
+		arch::thread_pool pool{3};
+		arch::world test_world{};
+		test_world.set_thread_pool(pool);
+		test_world.set_rollback_capacity(1);
+		test_world.create_entities(5000, counter_a{}, counter_b{});
+		test_world.create_entities(3000, counter_a{});
+		test_world.create_entities(3000, counter_b{});
+		
+		arch::update_group my_group{};
+		my_group.modify()
+		        .add_system<increment_system<counter_a>>("increment a"sv)
+		        .add_system<increment_system<counter_b>>("increment b"sv)
+		        .finish();
+		for (const auto &node: my_group.get_system_graph().nodes())
+		{
+			CHECK_EQ(node.previous_count, 0);
+		}
+		
+		constexpr int n_frames = 20;
+		for (int frame = 0; frame < n_frames; ++frame)
+		{
+			// the captured state shares all chunks, which get copied by the first write
+			test_world.capture_state();
+			my_group.execute(test_world);
+			for (const arch::system_base *system: my_group.get_contained_systems())
+			{
+				CHECK_EQ(static_cast<const counting_system *>(system)->n_changed, 8000);
+			}
+		}
+		
+		auto check_values = [&](int expected)
+		{
+			std::size_t n_checked = 0;
+			test_world.for_all(arch::with<counter_a>, [&](arch::entity, const counter_a &component)
+			{
+				n_checked += component.value == expected;
+			});
+			test_world.for_all(arch::with<counter_b>, [&](arch::entity, const counter_b &component)
+			{
+				n_checked += component.value == expected;
+			});
+			CHECK_EQ(n_checked, 16000);
+		};
+		check_values(n_frames);
+		test_world.rollback();
+		check_values(n_frames - 1);
+	}
+	
+	/// counts the entities whose counter_a changed since its last run, without taking counter_a as a parameter
+	class changed_reader_system : public counting_system
+	{
+	public:
+		changed_reader_system()
+		{
+			system_name = "read changed a";
+			accessed_components = arch::component_access::of<counter_b &>(filter);
+		}
+		
+		void execute(arch::world &execution_world) override
+		{
+			n_changed = 0;
+			execution_world.for_all(filter, _tracker, [this](arch::entity, counter_b &component)
+			{
+				++component.value;
+				++n_changed;
+			});
+		}
+	
+	private:
+		static constexpr auto filter = arch::with<counter_b &> && arch::changed<counter_a>;
+		
+		arch::change_tracker _tracker{};
+	};
+	
+	TEST_CASE("update group orders changed filters after writers")
+	{
+		using namespace std::literals::string_view_literals;
+		
+		arch::thread_pool pool{3};
+		arch::world test_world{};
+		test_world.set_thread_pool(pool);
+		test_world.create_entities(5000, counter_a{}, counter_b{});
+		test_world.create_entities(3000, counter_b{});
+		
+		arch::update_group my_group{};
+		my_group.modify()
+		        .add_system<increment_system<counter_a>>("increment a"sv)
+		        .add_system<changed_reader_system>()
+		        .finish();
+		
+		const arch::component_access &reader_access = my_group.get_contained_systems().back()->get_component_access();
+		CHECK(reader_access.get_reads().test(arch::det::component_index_of<counter_a>()));
+		CHECK(reader_access.get_writes().test(arch::det::component_index_of<counter_b>()));
+		auto nodes = my_group.get_system_graph().nodes();
+		CHECK_EQ(std::count_if(nodes.begin(), nodes.end(), [](const auto &node)
+		{
+			return node.previous_count == 0;
+		}), 1);
+		
+		// every write of the writer is seen by the next run of the reader, none gets lost
+		for (int frame = 0; frame < 50; ++frame)
+		{
+			my_group.execute(test_world);
+			CHECK_EQ(static_cast<const counting_system *>(my_group.get_contained_systems().back())->n_changed, 5000);
+		}
+	}
+}
@@ -0,0 +1,139 @@
+#include "doctest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include <archecs/world.hpp>
+#include <archecs/queries.hpp>
+#include <archecs/memory.hpp>
+
+namespace memory_test
+{
+	struct t1
+	{
+		int data = 2;
+	};
+	struct t2
+	{
+		double data = 128;
+	};
+	
+	using arch::world;
+	using arch::entity;
+	using arch::with;
+	
+	/// forwards to the default resource and counts the bytes currently allocated through it
+	struct counting_resource : std::pmr::memory_resource
+	{
+		std::size_t n_allocations = 0;
+		std::size_t n_bytes_in_use = 0;
+	
+	protected:
+		void *do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			++n_allocations;
+			n_bytes_in_use += bytes;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+		
+		void do_deallocate(void *allocated, std::size_t bytes, std::size_t alignment) override
+		{
+			n_bytes_in_use -= bytes;
+			std::pmr::new_delete_resource()->deallocate(allocated, bytes, alignment);
+		}
+		
+		[[nodiscard]]
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+	
+	TEST_CASE("huge_page_resource")
+	{
+		arch::huge_page_resource resource{};
+		void *allocated = resource.allocate(3 * 1024 * 1024, 4096);
+		CHECK_EQ(reinterpret_cast<std::uintptr_t>(allocated) % 4096, 0);
+		std::memset(allocated, 1, 3 * 1024 * 1024);
+		resource.deallocate(allocated, 3 * 1024 * 1024, 4096);
+		
+		arch::huge_page_resource other{};
+		CHECK(resource.is_equal(other));
+		CHECK_FALSE(resource.is_equal(*std::pmr::new_delete_resource()));
+	}
+	
+	TEST_CASE("world upstream resource")
+	{
+		counting_resource upstream{};
+		{
+			world test_world{upstream};
+			test_world.create_entities(5000, t1{}, t2{});
+			CHECK_NE(upstream.n_allocations, 0);
+			
+			std::unique_ptr<world> fork = test_world.fork();
+			fork->create_entities(100, t1{});
+			CHECK_EQ(fork->get_component<t1>(entity{0, 0}).data, 2);
+		}
+		CHECK_EQ(upstream.n_bytes_in_use, 0);
+	}
+	
+	TEST_CASE("world chunk resource per archetype")
+	{
+		counting_resource level_memory{};
+		counting_resource later_memory{};
+		{
+			world test_world{};
+			test_world.set_rollback_capacity(1);
+			test_world.set_chunk_resource<t1, t2>(level_memory);
+			std::span<const entity> created = test_world.create_entities(3000, t1{1}, t2{});
+			const std::vector<entity> level(created.begin(), created.end());
+			test_world.create_entities(3000, t1{});
+			const std::size_t n_level_allocations = level_memory.n_allocations;
+			CHECK_NE(n_level_allocations, 0);
+			
+			// chunks allocated before keep returning their memory to the previous resource
+			test_world.capture_state();
+			test_world.set_chunk_resource<t1, t2>(later_memory);
+			test_world.create_entities(2000, t1{2}, t2{});
+			CHECK_EQ(level_memory.n_allocations, n_level_allocations);
+			CHECK_NE(later_memory.n_allocations, 0);
+			
+			test_world.rollback();
+			CHECK_EQ(test_world.get_component<t1>(level.front()).data, 1);
+			std::size_t n_with_t2 = 0;
+			test_world.for_all(with<t2>, [&](entity, const t2 &)
+			{
+				++n_with_t2;
+			});
+			CHECK_EQ(n_with_t2, 3000);
+			
+			// merged chunks return their memory to the resource they came from as well
+			world staging_world{};
+			staging_world.set_chunk_resource<t1, t2>(later_memory);
+			staging_world.create_entities(1500, t1{3}, t2{});
+			test_world.merge_from(std::move(staging_world));
+			for (std::size_t i = 0; i < 200; ++i)
+			{
+				test_world.destroy_entity(level[i]);
+			}
+		}
+		CHECK_EQ(level_memory.n_bytes_in_use, 0);
+		CHECK_EQ(later_memory.n_bytes_in_use, 0);
+	}
+	
+	TEST_CASE("world monotonic chunks backed by huge pages")
+	{
+		arch::huge_page_resource huge_pages{};
+		std::pmr::monotonic_buffer_resource level_memory{arch::huge_page_resource::page_size, &huge_pages};
+		world test_world{};
+		test_world.set_chunk_resource<t1>(level_memory);
+		std::span<const entity> created = test_world.create_entities(10000, t1{5});
+		CHECK_EQ(test_world.get_component<t1>(created.back()).data, 5);
+		test_world.destroy_entity(created.front());
+		test_world.add_component(created.back(), t2{});
+		CHECK_EQ(test_world.get_component<t1>(created.back()).data, 5);
+	}
+}
@@ -109,6 +109,27 @@ namespace test_space
 			CHECK(q1.filter(all_type_span));
 		}
 	}
+	TEST_CASE("Component Mask Query")
+	{
+		auto all_types = ids_of<t1, t2, t3>();
+		det::component_mask all_mask = det::component_mask::of(all_types);
+		CHECK(all_mask == det::component_mask::of<t3, t1, t2>());
+		CHECK(all_mask.test(det::component_index_of<t2>()));
+		CHECK_FALSE(all_mask.test(det::component_index_of<t4>()));
+		CHECK(all_mask.intersects(det::mask_of<t4, t1>()));
+		CHECK_FALSE(all_mask.intersects(det::mask_of<t4>()));
+		
+		// masks have to come to the same result as the sorted type lists
+		CHECK(with<t1, t3>.matches(all_mask));
+		CHECK_FALSE(with<t1, t4>.matches(all_mask));
+		CHECK(has<t2>.matches(all_mask));
+		CHECK(with_optional<t4>.matches(all_mask));
+		CHECK(with_exactly<t2, t3, t1>.matches(all_mask));
+		CHECK_FALSE(with_exactly<t2, t3>.matches(all_mask));
+		CHECK_FALSE((not with<t1>).matches(all_mask));
+		CHECK((with<t1> && not with<t4>).matches(all_mask));
+		CHECK_FALSE((with<t1> && not with<t2>).matches(all_mask));
+	}
 
 namespace
 {
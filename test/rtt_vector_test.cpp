@@ -75,4 +75,4 @@ namespace
 		rtt_vector other = std::move(vector);
 		CHECK_EQ(other.size(), 1);
 	}
-}
\ No newline at end of file
+}
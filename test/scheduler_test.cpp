@@ -1,5 +1,8 @@
 #include "doctest.h"
 
+#include <mutex>
+#include <vector>
+
 #include <archecs/internal/scheduler.hpp>
 #include <archecs/system.hpp>
 #include <archecs/update_group.hpp>
@@ -60,4 +63,47 @@ namespace
 		CHECK_EQ(result[2]->id, 3);
 		CHECK_EQ(result[3]->id, 4);
 	}
+	
+	TEST_CASE("scheduler graph")
+	{
+		scheduler<t1> my_scheduler{};
+		t1 first{1};
+		t1 second{2};
+		std::array second_dep{&first};
+		t1 third{3};
+		std::array third_dep{&first};
+		t1 fourth{4};
+		std::array fourth_dep{&second, &third};
+		
+		my_scheduler.add_job(first, std::span<t1 *>(), {});
+		my_scheduler.add_job(second, second_dep, {});
+		my_scheduler.add_job(third, third_dep, {});
+		my_scheduler.add_job(fourth, fourth_dep, {});
+		
+		auto graph = my_scheduler.schedule_graph();
+		auto nodes = graph.nodes();
+		REQUIRE_EQ(nodes.size(), 4);
+		CHECK_EQ(nodes[0].job->id, 1);
+		CHECK_EQ(nodes[0].previous_count, 0);
+		CHECK_EQ(nodes[0].following, std::vector<std::size_t>{1, 2});
+		CHECK_EQ(nodes[1].previous_count, 1);
+		CHECK_EQ(nodes[2].previous_count, 1);
+		CHECK_EQ(nodes[1].following, std::vector<std::size_t>{3});
+		CHECK_EQ(nodes[2].following, std::vector<std::size_t>{3});
+		CHECK_EQ(nodes[3].job->id, 4);
+		CHECK_EQ(nodes[3].previous_count, 2);
+		CHECK(nodes[3].following.empty());
+		
+		arch::thread_pool pool{2};
+		std::vector<int> finished{};
+		std::mutex finished_mutex{};
+		graph.run(pool, [&](t1 &job)
+		{
+			std::lock_guard lock(finished_mutex);
+			finished.push_back(job.id);
+		});
+		REQUIRE_EQ(finished.size(), 4);
+		CHECK_EQ(finished.front(), 1);
+		CHECK_EQ(finished.back(), 4);
+	}
 }
\ No newline at end of file
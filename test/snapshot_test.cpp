@@ -0,0 +1,221 @@
+#include "doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <vector>
+
+#include <archecs/world.hpp>
+#include <archecs/queries.hpp>
+#include <archecs/snapshot.hpp>
+
+namespace snapshot_test
+{
+	struct t1
+	{
+		int data = 2;
+	};
+	struct t2
+	{
+		double data = 128;
+	};
+	struct alignas(128) t3
+	{
+		float data = 16;
+	};
+	
+	using arch::world;
+	using arch::entity;
+	using arch::with;
+	using arch::world_snapshot;
+	
+	/// removes the file once the test is done
+	struct temporary_file
+	{
+		std::filesystem::path path;
+		
+		explicit temporary_file(const char *name = "arch_ecs_snapshot_test.bin")
+				: path(std::filesystem::temp_directory_path() / name)
+		{}
+		
+		~temporary_file()
+		{
+			std::filesystem::remove(path);
+		}
+	};
+	
+	TEST_CASE("snapshot round trip")
+	{
+		temporary_file file{};
+		std::vector<entity> created{};
+		entity reused_after_load{};
+		{
+			world saved_world{};
+			std::span<const entity> with_t1 = saved_world.create_entities(3000, t1{7});
+			created.assign(with_t1.begin(), with_t1.end());
+			for (int i = 0; i < 500; ++i)
+			{
+				entity current = saved_world.create_entity();
+				saved_world.add_components(current, t1{i}, t2{i * 0.5}, t3{});
+				created.push_back(current);
+			}
+			created.push_back(saved_world.create_entity());
+			
+			saved_world.destroy_entity(created[10]);
+			saved_world.destroy_entity(created[3100]);
+			reused_after_load = saved_world.create_entity();
+			saved_world.destroy_entity(reused_after_load);
+			
+			REQUIRE(world_snapshot::write<t1, t2, t3>(saved_world, file.path));
+		}
+		
+		world loaded_world{};
+		REQUIRE(world_snapshot::load<t1, t2, t3>(loaded_world, file.path));
+		
+		CHECK_FALSE(loaded_world.is_alive(created[10]));
+		CHECK_FALSE(loaded_world.is_alive(created[3100]));
+		CHECK(loaded_world.is_alive(created.back()));
+		CHECK(loaded_world.get_archetype_of(created.back()).get_contained_types().empty());
+		CHECK_EQ(loaded_world.get_component<t1>(created[0]).data, 7);
+		CHECK_EQ(loaded_world.get_component<t1>(created[3200]).data, 200);
+		CHECK_EQ(loaded_world.get_component<t2>(created[3200]).data, 100.0);
+		
+		std::size_t n_with_t1 = 0;
+		loaded_world.for_all(with<t1>, [&](entity, const t1 &)
+		{
+			++n_with_t1;
+		});
+		CHECK_EQ(n_with_t1, 3498);
+		
+		// the free list is restored as well
+		entity reused = loaded_world.create_entity();
+		CHECK_EQ(reused.id, reused_after_load.id);
+		CHECK_EQ(reused.version, reused_after_load.version + 1);
+		
+		// loaded entities behave like all others
+		loaded_world.remove_components<t2>(created[3200]);
+		loaded_world.add_component(created[0], t2{3.0});
+		for (std::size_t i = 1000; i < 3000; ++i)
+		{
+			loaded_world.destroy_entity(created[i]);
+		}
+		CHECK_EQ(loaded_world.get_component<t1>(created[3200]).data, 200);
+		CHECK_EQ(loaded_world.get_component<t2>(created[0]).data, 3.0);
+		std::span<const entity> added = loaded_world.create_entities(10, t1{1});
+		CHECK_EQ(loaded_world.get_component<t1>(added.back()).data, 1);
+	}
+	
+	TEST_CASE("snapshot load failures")
+	{
+		temporary_file file{};
+		{
+			world saved_world{};
+			saved_world.create_entities(10, t1{}, t2{});
+			REQUIRE(world_snapshot::write<t1, t2>(saved_world, file.path));
+		}
+		
+		{
+			world loaded_world{};
+			CHECK_FALSE(world_snapshot::load<t1>(loaded_world, file.path));
+			CHECK(loaded_world.create_entities(1).front() == entity{0, 0});
+		}
+		
+		{
+			// unknown component types fail before the existing file gets overwritten
+			world saved_world{};
+			saved_world.create_entities(10, t1{}, t2{});
+			CHECK_FALSE(world_snapshot::write<t1>(saved_world, file.path));
+			CHECK_FALSE(world_snapshot::write_delta<t2>(saved_world, file.path, 0));
+			world loaded_world{};
+			CHECK(world_snapshot::load<t1, t2>(loaded_world, file.path));
+		}
+		
+		{
+			std::ofstream broken(file.path, std::ios::binary | std::ios::trunc);
+			broken << "not a snapshot";
+		}
+		world loaded_world{};
+		CHECK_FALSE(world_snapshot::load<t1, t2>(loaded_world, file.path));
+		CHECK_FALSE(world_snapshot::load<t1, t2>(loaded_world, file.path.string() + ".missing"));
+	}
+	
+	TEST_CASE("snapshot delta")
+	{
+		temporary_file base_file{"arch_ecs_snapshot_base.bin"};
+		temporary_file first_delta{"arch_ecs_snapshot_delta_1.bin"};
+		temporary_file second_delta{"arch_ecs_snapshot_delta_2.bin"};
+		temporary_file unchanged_delta{"arch_ecs_snapshot_delta_0.bin"};
+		
+		world saved_world{};
+		std::vector<entity> created{};
+		std::span<const entity> with_t1 = saved_world.create_entities(3000, t1{1});
+		created.assign(with_t1.begin(), with_t1.end());
+		std::span<const entity> with_t2 = saved_world.create_entities(500, t1{2}, t2{});
+		created.insert(created.end(), with_t2.begin(), with_t2.end());
+		
+		std::optional<arch::det::change_tick> base_tick = world_snapshot::write<t1, t2, t3>(saved_world, base_file.path);
+		REQUIRE(base_tick);
+		
+		// unchanged chunks stay out of the delta
+		std::optional<arch::det::change_tick> unchanged_tick = world_snapshot::write_delta<t1, t2, t3>(saved_world, unchanged_delta.path,
+		                                                                                                 *base_tick);
+		REQUIRE(unchanged_tick);
+		CHECK_LT(std::filesystem::file_size(unchanged_delta.path), std::filesystem::file_size(base_file.path) / 10);
+		
+		saved_world.add_component(created[5], t1{50});
+		saved_world.add_component(created[3100], t3{});
+		for (std::size_t i = 1000; i < 1200; ++i)
+		{
+			saved_world.destroy_entity(created[i]);
+		}
+		std::span<const entity> added = saved_world.create_entities(1500, t1{3}, t3{});
+		created.insert(created.end(), added.begin(), added.end());
+		std::optional<arch::det::change_tick> first_tick = world_snapshot::write_delta<t1, t2, t3>(saved_world, first_delta.path, *unchanged_tick);
+		REQUIRE(first_tick);
+		
+		saved_world.add_component(created[3300], t1{33});
+		for (std::size_t i = 3500; i < 4500; ++i)
+		{
+			saved_world.destroy_entity(created[i]);
+		}
+		saved_world.remove_components<t2>(created[3000]);
+		REQUIRE(world_snapshot::write_delta<t1, t2, t3>(saved_world, second_delta.path, *first_tick));
+		
+		world loaded_world{};
+		REQUIRE(world_snapshot::load<t1, t2, t3>(loaded_world, base_file.path));
+		// deltas only apply on top of the state they are based on
+		CHECK_FALSE(world_snapshot::apply_delta<t1, t2, t3>(loaded_world, second_delta.path));
+		CHECK_FALSE(world_snapshot::apply_delta<t1, t2, t3>(loaded_world, base_file.path));
+		CHECK_FALSE(world_snapshot::apply_delta<t1, t2, t3>(loaded_world, first_delta.path));
+		CHECK(loaded_world.is_alive(created[1000]));
+		
+		world rebuilt_world{};
+		REQUIRE(world_snapshot::load<t1, t2, t3>(rebuilt_world, base_file.path));
+		REQUIRE(world_snapshot::apply_delta<t1, t2, t3>(rebuilt_world, unchanged_delta.path));
+		REQUIRE(world_snapshot::apply_delta<t1, t2, t3>(rebuilt_world, first_delta.path));
+		REQUIRE(world_snapshot::apply_delta<t1, t2, t3>(rebuilt_world, second_delta.path));
+		
+		for (entity current: created)
+		{
+			REQUIRE_EQ(rebuilt_world.is_alive(current), saved_world.is_alive(current));
+			if (saved_world.is_alive(current))
+			{
+				CHECK_EQ(rebuilt_world.get_component<t1>(current).data, saved_world.get_component<t1>(current).data);
+				CHECK_EQ(rebuilt_world.has_component<t2>(current), saved_world.has_component<t2>(current));
+				CHECK_EQ(rebuilt_world.has_component<t3>(current), saved_world.has_component<t3>(current));
+			}
+		}
+		CHECK_EQ(rebuilt_world.get_component<t1>(created[5]).data, 50);
+		CHECK_EQ(rebuilt_world.get_component<t1>(created[3300]).data, 33);
+		
+		std::size_t n_with_t3 = 0;
+		rebuilt_world.for_all(with<t3>, [&](entity, const t3 &)
+		{
+			++n_with_t3;
+		});
+		CHECK_EQ(n_with_t3, 501);
+		
+		// the free list matches as well
+		CHECK(rebuilt_world.create_entity() == saved_world.create_entity());
+	}
+}
@@ -0,0 +1,107 @@
+#include "doctest.h"
+
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include <archecs/thread_pool.hpp>
+
+namespace
+{
+	using arch::thread_pool;
+	
+	TEST_CASE("thread_pool runs every task once")
+	{
+		thread_pool pool{3};
+		CHECK_EQ(pool.thread_count(), 4);
+		
+		std::vector<std::atomic<int>> calls(1000);
+		std::atomic<bool> invalid_thread_index = false;
+		pool.run(calls.size(), [&](std::size_t task_index, std::size_t thread_index)
+		{
+			calls[task_index].fetch_add(1);
+			if (thread_index >= pool.thread_count())
+			{
+				invalid_thread_index = true;
+			}
+		});
+		
+		for (const std::atomic<int> &call_count: calls)
+		{
+			CHECK_EQ(call_count.load(), 1);
+		}
+		CHECK_FALSE(invalid_thread_index.load());
+	}
+	
+	TEST_CASE("thread_pool reuse")
+	{
+		thread_pool pool{2};
+		std::atomic<std::size_t> sum = 0;
+		for (std::size_t job = 0; job < 200; ++job)
+		{
+			pool.run(job % 7, [&](std::size_t task_index, std::size_t)
+			{
+				sum.fetch_add(task_index + 1);
+			});
+		}
+		
+		std::size_t expected = 0;
+		for (std::size_t job = 0; job < 200; ++job)
+		{
+			const std::size_t n_tasks = job % 7;
+			expected += n_tasks * (n_tasks + 1) / 2;
+		}
+		CHECK_EQ(sum.load(), expected);
+	}
+	
+	TEST_CASE("thread_pool uneven tasks")
+	{
+		thread_pool pool{3};
+		constexpr std::size_t n_tasks = 64;
+		std::vector<std::atomic<int>> calls(n_tasks);
+		// all expensive tasks start out in the range of the calling thread, the other threads have to steal them
+		pool.run(n_tasks, [&](std::size_t task_index, std::size_t)
+		{
+			if (task_index < n_tasks / 4)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+			}
+			calls[task_index].fetch_add(1);
+		});
+		
+		for (const std::atomic<int> &call_count: calls)
+		{
+			CHECK_EQ(call_count.load(), 1);
+		}
+	}
+	
+	TEST_CASE("thread_pool nested run")
+	{
+		thread_pool pool{3};
+		std::atomic<std::size_t> n_inner_tasks = 0;
+		pool.run(8, [&](std::size_t, std::size_t)
+		{
+			// nobody waits inside help_until, so the calling thread runs the nested tasks itself
+			pool.run(4, [&](std::size_t, std::size_t)
+			{
+				n_inner_tasks.fetch_add(1);
+			});
+		});
+		CHECK_EQ(n_inner_tasks.load(), 32);
+	}
+	
+	TEST_CASE("thread_pool without workers")
+	{
+		thread_pool pool{0};
+		CHECK_EQ(pool.thread_count(), 1);
+		
+		std::vector<std::size_t> order{};
+		pool.run(5, [&](std::size_t task_index, std::size_t thread_index)
+		{
+			CHECK_EQ(thread_index, 0);
+			order.push_back(task_index);
+		});
+		CHECK_EQ(order, std::vector<std::size_t>{0, 1, 2, 3, 4});
+	}
+}
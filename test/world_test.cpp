@@ -1,5 +1,13 @@
 #include "doctest.h"
 
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 #include <archecs/world.hpp>
 #include <archecs/queries.hpp>
 
@@ -25,6 +33,7 @@ namespace world_test
 	using arch::world;
 	using arch::entity;
 	using arch::with;
+	using arch::with_optional;
 	
 	TEST_CASE("world create entity")
 	{
@@ -87,12 +96,8 @@ namespace world_test
 		test_world.destroy_entity(created1);
 		
 		CHECK(not test_world.is_alive(created1));
-		CHECK_EQ(entities_archetype.entities().size(), 0);
-		auto archetypes_component_vectors = entities_archetype.internal().component_vectors();
-		for (const auto &archetypes_component_vector: archetypes_component_vectors)
-		{
-			CHECK_EQ(archetypes_component_vector.size(), 0);
-		}
+		CHECK_EQ(entities_archetype.size(), 0);
+		CHECK_EQ(entities_archetype.chunk_count(), 0);
 	}
 	
 	TEST_CASE("world remove components")
@@ -217,7 +222,7 @@ namespace world_test
 		test_world.add_components(created1, delete_detector{});
 		CHECK_EQ(delete_detector::delete_count, delete_detector::construct_count - 1);
 		
-		test_world.remove_components<t3>(created1);
+		test_world.remove_components<delete_detector>(created1);
 		CHECK_EQ(delete_detector::delete_count, delete_detector::construct_count);
 	}
 	
@@ -294,4 +299,1006 @@ namespace world_test
 			CHECK_EQ(my_t3.data, 512);
 		});
 	}
-}
\ No newline at end of file
+	
+	TEST_CASE("world query cache")
+	{
+		world test_world{};
+		entity first = test_world.create_entity();
+		test_world.add_components(first, t1{1}, t2{2});
+		
+		const auto &cached_query = test_world.query(with<t2, t1>);
+		// the same cache is returned for every use of the filter
+		CHECK_EQ(&cached_query, &test_world.query(with<t2, t1>));
+		REQUIRE_EQ(cached_query.matched_archetypes().size(), 1);
+		// every filter type gets its own cache, independent of its type id
+		CHECK_NE(static_cast<const void *>(&cached_query), static_cast<const void *>(&test_world.query(with<t1>)));
+		
+		// archetypes created later on are added to the existing cache
+		entity second = test_world.create_entity();
+		test_world.add_components(second, t3{3}, t1{4}, t2{5});
+		entity third = test_world.create_entity();
+		test_world.add_components(third, t3{6}, t1{7});
+		REQUIRE_EQ(cached_query.matched_archetypes().size(), 2);
+		
+		const auto &matched = cached_query.matched_archetypes()[1];
+		const arch::archetype &second_archetype = test_world.get_archetype_of(second);
+		CHECK_NE(matched.archetype_index, cached_query.matched_archetypes()[0].archetype_index);
+		// column indices are sorted by type_id just like the types of the archetype
+		constexpr std::array wanted_types = arch::ids_of<t1, t2>();
+		for (std::size_t i = 0; i < wanted_types.size(); ++i)
+		{
+			CHECK_EQ(second_archetype.get_contained_types()[matched.column_indices[i]], wanted_types[i]);
+		}
+		
+		int sum = 0;
+		test_world.for_all(with<t2, t1>, [&](entity, const t2 &b, const t1 &a)
+		{
+			sum += a.data + b.data;
+		});
+		CHECK_EQ(sum, 1 + 2 + 4 + 5);
+		
+		std::size_t n_with_t3 = 0;
+		test_world.for_all_with([&](entity, t3 &, t2 *)
+		{
+			++n_with_t3;
+		});
+		CHECK_EQ(n_with_t3, 2);
+	}
+	
+	TEST_CASE("world entities spanning multiple chunks")
+	{
+		world test_world{};
+		std::vector<entity> created{};
+		for (int i = 0; i < 5000; ++i)
+		{
+			entity current = test_world.create_entity();
+			test_world.add_components(current, t1{i}, t2{-i});
+			created.push_back(current);
+		}
+		
+		const arch::archetype &entities_archetype = test_world.get_archetype_of(created.front());
+		CHECK_GT(entities_archetype.chunk_count(), 1);
+		
+		for (std::size_t i = 0; i < created.size(); i += 2)
+		{
+			test_world.destroy_entity(created[i]);
+		}
+		CHECK_EQ(entities_archetype.size(), created.size() / 2);
+		
+		for (std::size_t i = 1; i < created.size(); i += 2)
+		{
+			CHECK_EQ(test_world.get_component<t1>(created[i]).data, static_cast<int>(i));
+			CHECK_EQ(test_world.get_component<t2>(created[i]).data, -static_cast<int>(i));
+		}
+		
+		std::size_t n_iterated = 0;
+		test_world.for_all(with<const t1 &, const t2 &>, [&](entity, const t1 &my_t1, const t2 &my_t2)
+		{
+			CHECK_EQ(my_t1.data, -my_t2.data);
+			++n_iterated;
+		});
+		CHECK_EQ(n_iterated, created.size() / 2);
+	}
+	
+	struct alignas(64) aligned_float8
+	{
+		float values[8];
+	};
+	
+	TEST_CASE("world foreach chunk")
+	{
+		world test_world{};
+		constexpr std::size_t n_entities = 2000;
+		for (std::size_t i = 0; i < n_entities; ++i)
+		{
+			entity created = test_world.create_entity();
+			test_world.add_components(created, t1{static_cast<int>(i)}, t2{1});
+			if (i % 2 == 0)
+			{
+				test_world.add_component(created, t3{5});
+			}
+		}
+		REQUIRE_GT(test_world.get_archetype_of(entity{0, 0}).chunk_count(), 1);
+		
+		std::size_t n_visited = 0;
+		std::size_t n_chunks = 0;
+		test_world.for_each_chunk(with<t2, t1> && with_optional<t3>,
+		                          [&](std::span<const entity> entities, std::span<t2> second, std::span<const t1> first, std::span<t3> third)
+		                          {
+			                          REQUIRE_EQ(second.size(), entities.size());
+			                          REQUIRE_EQ(first.size(), entities.size());
+			                          CHECK((third.empty() || third.size() == entities.size()));
+			                          for (std::size_t i = 0; i < entities.size(); ++i)
+			                          {
+				                          CHECK_EQ(static_cast<std::size_t>(first[i].data), entities[i].id);
+				                          second[i].data += third.empty() ? 0 : third[i].data;
+			                          }
+			                          n_visited += entities.size();
+			                          ++n_chunks;
+		                          });
+		CHECK_EQ(n_visited, n_entities);
+		CHECK_GT(n_chunks, 2);
+		
+		test_world.for_all(with<t2, t1> && with_optional<t3>, [](entity current, const t2 &second, const t1 &first, const t3 *third)
+		{
+			CHECK_EQ(static_cast<std::size_t>(first.data), current.id);
+			CHECK_EQ(second.data, third != nullptr ? 6 : 1);
+			CHECK_EQ(third != nullptr, first.data % 2 == 0);
+		});
+	}
+	
+	TEST_CASE("world foreach parallel")
+	{
+		arch::thread_pool pool{3};
+		world test_world{};
+		test_world.set_thread_pool(pool);
+		CHECK_EQ(&test_world.get_thread_pool(), &pool);
+		
+		constexpr std::size_t n_entities = 5000;
+		test_world.create_entities(n_entities, t1{1}, t2{2});
+		test_world.create_entities(n_entities, t1{1}, t3{3});
+		// a few small archetypes next to the big ones
+		test_world.create_entities(3, t1{1});
+		test_world.create_entities(1, t1{1}, t4{});
+		test_world.create_entities(70, t1{1}, t2{2}, t3{3});
+		
+		for (int run = 0; run < 10; ++run)
+		{
+			test_world.for_all_parallel(with<t1>, [](entity, t1 &first)
+			{
+				first.data += 1;
+			});
+		}
+		
+		std::size_t n_visited = 0;
+		test_world.for_all(with<t1>, [&](entity, const t1 &first)
+		{
+			CHECK_EQ(first.data, 11);
+			++n_visited;
+		});
+		CHECK_EQ(n_visited, 2 * n_entities + 3 + 1 + 70);
+	}
+	
+	TEST_CASE("world foreach parallel marks written chunks")
+	{
+		arch::thread_pool pool{3};
+		world test_world{};
+		test_world.set_thread_pool(pool);
+		test_world.set_rollback_capacity(1);
+		constexpr std::size_t n_entities = 100;
+		test_world.create_entities(n_entities, t1{1}, t2{2});
+		
+		arch::change_tracker tracker{};
+		auto count_changed = [&]()
+		{
+			std::size_t n_visited = 0;
+			test_world.for_all(with<t1> && arch::changed<t2>, tracker, [&](entity, const t1 &)
+			{
+				++n_visited;
+			});
+			return n_visited;
+		};
+		CHECK_EQ(count_changed(), n_entities);
+		CHECK_EQ(count_changed(), 0);
+		
+		// the filter only names the type, the parameter of the function decides if the component is written
+		test_world.capture_state();
+		std::unique_ptr<world> fork = test_world.fork();
+		test_world.for_all_parallel(with<t2>, [](entity, const t2 &)
+		{
+		});
+		CHECK_EQ(count_changed(), 0);
+		test_world.for_all_parallel(with<t2>, [](entity, t2 &second)
+		{
+			second.data = 42;
+		});
+		CHECK_EQ(count_changed(), n_entities);
+		
+		// shared chunks get copied before the write
+		CHECK_EQ(fork->get_component<t2>(entity{0, 0}).data, 2);
+		CHECK_EQ(test_world.get_component<t2>(entity{0, 0}).data, 42);
+		test_world.rollback();
+		CHECK_EQ(test_world.get_component<t2>(entity{0, 0}).data, 2);
+	}
+	
+	TEST_CASE("world changed filter")
+	{
+		world test_world{};
+		constexpr std::size_t n_entities = 5000;
+		test_world.create_entities(n_entities, t1{1}, t2{2});
+		const arch::archetype &created_archetype = test_world.get_archetype_of(entity{0, 0});
+		const std::size_t chunk_capacity = created_archetype.chunk_capacity();
+		REQUIRE_GT(created_archetype.chunk_count(), 2);
+		
+		arch::change_tracker tracker{};
+		auto count_changed = [&]()
+		{
+			std::size_t n_visited = 0;
+			test_world.for_all(with<t1> && arch::changed<t2>, tracker, [&](entity, const t1 &)
+			{
+				++n_visited;
+			});
+			return n_visited;
+		};
+		
+		// everything is new for the first run
+		CHECK_EQ(count_changed(), n_entities);
+		CHECK_EQ(count_changed(), 0);
+		
+		// only the chunk of the written entity gets visited
+		test_world.get_component<t2>(entity{static_cast<arch::entity_id_t>(chunk_capacity + 1), 0}).data = 5;
+		CHECK_EQ(count_changed(), chunk_capacity);
+		CHECK_EQ(count_changed(), 0);
+		
+		// reading does not count as a change, taking a component by non const reference or span does
+		test_world.for_all(with<t2>, [](entity, const t2 &)
+		{
+		});
+		test_world.for_all(with<t1 &>, [](entity, t1 &)
+		{
+		});
+		CHECK_EQ(count_changed(), 0);
+		test_world.for_each_chunk(with<t2>, [](std::span<const entity>, std::span<t2>)
+		{
+		});
+		CHECK_EQ(count_changed(), n_entities);
+		
+		// generic functions might write to everything
+		test_world.for_all(with<t2 &>, [](entity, auto &)
+		{
+		});
+		CHECK_EQ(count_changed(), n_entities);
+		
+		// adding entities changes the last chunk, the filter also works for chunk queries
+		test_world.create_entities(1, t1{1}, t2{2});
+		std::size_t n_visited = 0;
+		arch::change_tracker chunk_tracker{};
+		test_world.for_each_chunk(arch::changed<t1, t2>, chunk_tracker, [&](std::span<const entity> entities)
+		{
+			n_visited += entities.size();
+		});
+		CHECK_EQ(n_visited, n_entities + 1);
+		CHECK_EQ(count_changed(), (n_entities + 1) % chunk_capacity);
+		
+		// changed filters combine with other filters
+		arch::change_tracker tracker_without_t3{};
+		auto count_changed_without_t3 = [&]()
+		{
+			std::size_t n_changed = 0;
+			test_world.for_all(with<t1> && !with<t3> && arch::changed<t2>, tracker_without_t3, [&](entity, const t1 &)
+			{
+				++n_changed;
+			});
+			return n_changed;
+		};
+		CHECK_EQ(count_changed_without_t3(), n_entities + 1);
+		test_world.create_entities(10, t1{1}, t2{2}, t3{3});
+		CHECK_EQ(count_changed_without_t3(), 0);
+	}
+	
+	TEST_CASE("world changed filter with several consumers")
+	{
+		world test_world{};
+		test_world.create_entities(3000, t1{1}, t2{2});
+		
+		// for example network sync and render upload, both interested in the same component
+		arch::change_tracker sync_tracker{};
+		arch::change_tracker upload_tracker{};
+		auto count_changed = [&](arch::change_tracker &tracker)
+		{
+			std::size_t n_visited = 0;
+			test_world.for_all(with<t1> && arch::changed<t2>, tracker, [&](entity, const t1 &)
+			{
+				++n_visited;
+			});
+			return n_visited;
+		};
+		CHECK_EQ(count_changed(sync_tracker), 3000);
+		CHECK_EQ(count_changed(upload_tracker), 3000);
+		
+		test_world.get_component<t2>(entity{0, 0}).data = 5;
+		const std::size_t chunk_capacity = test_world.get_archetype_of(entity{0, 0}).chunk_capacity();
+		CHECK_EQ(count_changed(sync_tracker), chunk_capacity);
+		CHECK_EQ(count_changed(upload_tracker), chunk_capacity);
+		CHECK_EQ(count_changed(sync_tracker), 0);
+		CHECK_EQ(count_changed(upload_tracker), 0);
+	}
+	
+	TEST_CASE("world changed filter ignores the writes of its own query")
+	{
+		arch::thread_pool pool{3};
+		world test_world{};
+		test_world.set_thread_pool(pool);
+		constexpr std::size_t n_entities = 100;
+		test_world.create_entities(n_entities, t1{1}, t2{2});
+		
+		arch::change_tracker tracker{};
+		auto count_and_write = [&]()
+		{
+			std::size_t n_visited = 0;
+			test_world.for_all(with<t2 &> && arch::changed<t2>, tracker, [&](entity, t2 &second)
+			{
+				++second.data;
+				++n_visited;
+			});
+			return n_visited;
+		};
+		CHECK_EQ(count_and_write(), n_entities);
+		CHECK_EQ(count_and_write(), 0);
+		CHECK_EQ(test_world.get_component<t2>(entity{0, 0}).data, 3);
+		
+		// writes of other queries are still seen, also by the other kinds of queries
+		test_world.for_all(with<t2 &>, [](entity, t2 &)
+		{
+		});
+		CHECK_EQ(count_and_write(), n_entities);
+		CHECK_EQ(count_and_write(), 0);
+		
+		arch::change_tracker parallel_tracker{};
+		std::atomic<std::size_t> n_parallel_visited = 0;
+		auto count_and_write_parallel = [&]()
+		{
+			n_parallel_visited = 0;
+			test_world.for_all_parallel(with<t2 &> && arch::changed<t2>, parallel_tracker, [&](entity, t2 &second)
+			{
+				++second.data;
+				++n_parallel_visited;
+			});
+			return n_parallel_visited.load();
+		};
+		CHECK_EQ(count_and_write_parallel(), n_entities);
+		CHECK_EQ(count_and_write_parallel(), 0);
+		
+		// the parallel query wrote after the last run of the first one
+		CHECK_EQ(count_and_write(), n_entities);
+		CHECK_EQ(count_and_write_parallel(), n_entities);
+		CHECK_EQ(count_and_write_parallel(), 0);
+	}
+	
+	TEST_CASE("world over-aligned component columns")
+	{
+		world test_world{};
+		for (int i = 0; i < 1000; ++i)
+		{
+			entity current = test_world.create_entity();
+			test_world.add_components(current, t1{i}, aligned_float8{});
+		}
+		
+		test_world.for_all(with<t1 &, aligned_float8 &>, [](entity, t1 &my_t1, aligned_float8 &my_float8)
+		{
+			CHECK_EQ(reinterpret_cast<std::uintptr_t>(&my_float8) % alignof(aligned_float8), 0);
+			CHECK_EQ(reinterpret_cast<std::uintptr_t>(&my_t1) % alignof(t1), 0);
+		});
+		CHECK_EQ(arch::info_of<aligned_float8>().alignment, alignof(aligned_float8));
+	}
+	
+	TEST_CASE("world cached archetype transitions")
+	{
+		world test_world{};
+		std::vector<entity> created{};
+		for (int i = 0; i < 100; ++i)
+		{
+			entity current = test_world.create_entity();
+			test_world.add_components(current, t1{i});
+			created.push_back(current);
+		}
+		// stays inside the archetype containing only t1
+		entity probe = test_world.create_entity();
+		test_world.add_components(probe, t1{});
+		
+		CHECK_EQ(test_world.get_archetype_of(probe).internal().find_add_edge(arch::id_of<t2>()), nullptr);
+		
+		for (int repetition = 0; repetition < 3; ++repetition)
+		{
+			for (entity current: created)
+			{
+				test_world.add_component(current, t2{repetition});
+			}
+			
+			const arch::det::archetype_transition *add_edge = test_world.get_archetype_of(probe).internal().find_add_edge(arch::id_of<t2>());
+			REQUIRE_NE(add_edge, nullptr);
+			CHECK_EQ(test_world.get_archetype_of(created.front()).size(), created.size());
+			CHECK_EQ(test_world.get_archetype_of(probe).size(), 1);
+			CHECK_EQ(add_edge->moved_columns.size(), 1);
+			CHECK(add_edge->destroyed_columns.empty());
+			
+			const arch::archetype &t1_t2_archetype = test_world.get_archetype_of(created.front());
+			for (entity current: created)
+			{
+				test_world.remove_component(current, arch::id_of<t2>());
+			}
+			
+			const arch::det::archetype_transition *remove_edge = t1_t2_archetype.internal().find_remove_edge(arch::id_of<t2>());
+			REQUIRE_NE(remove_edge, nullptr);
+			CHECK_EQ(remove_edge->destroyed_columns.size(), 1);
+		}
+		
+		for (std::size_t i = 0; i < created.size(); ++i)
+		{
+			CHECK_EQ(test_world.get_component<t1>(created[i]).data, static_cast<int>(i));
+			CHECK_FALSE(test_world.has_component<t2>(created[i]));
+		}
+	}
+	
+	TEST_CASE("world modify component set with absent types")
+	{
+		world test_world{};
+		entity created1 = test_world.create_entity();
+		test_world.add_components(created1, t1{}, t2{}, t3{});
+		entity created2 = test_world.create_entity();
+		test_world.add_components(created2, t1{5});
+		
+		// combining the ids of {t1} and the removed {t2, t3} gives the same value as combining {t1, t2, t3}
+		std::array removed_types{arch::id_of<t2>(), arch::id_of<t3>()};
+		test_world.modify_component_set(created2, {}, {}, removed_types);
+		
+		auto created2_types = test_world.get_archetype_of(created2).get_contained_types();
+		REQUIRE_EQ(created2_types.size(), 1);
+		CHECK_EQ(created2_types[0], arch::id_of<t1>());
+		CHECK_EQ(test_world.get_component<t1>(created2).data, 5);
+		CHECK_EQ(test_world.get_archetype_of(created1).get_contained_types().size(), 3);
+	}
+	
+	TEST_CASE("world entity slots are recycled")
+	{
+		world test_world{};
+		entity first = test_world.create_entity();
+		entity second = test_world.create_entity();
+		entity third = test_world.create_entity();
+		test_world.add_component(second, t1{2});
+		test_world.add_component(third, t1{3});
+		
+		test_world.destroy_entity(first);
+		test_world.destroy_entity(second);
+		CHECK_FALSE(test_world.is_alive(first));
+		CHECK_FALSE(test_world.is_alive(second));
+		CHECK_EQ(test_world.get_component<t1>(third).data, 3);
+		
+		// the most recently destroyed slot is reused first
+		entity reused_second = test_world.create_entity();
+		entity reused_first = test_world.create_entity();
+		CHECK_EQ(reused_second.id, second.id);
+		CHECK_EQ(reused_first.id, first.id);
+		CHECK_NE(reused_second.version, second.version);
+		CHECK_FALSE(test_world.is_alive(second));
+		CHECK(test_world.is_alive(reused_second));
+		CHECK_FALSE(test_world.has_component<t1>(reused_second));
+		
+		// reusing slots does not grow the entity index
+		entity fresh = test_world.create_entity();
+		CHECK_EQ(fresh.id, 3);
+		
+		test_world.destroy_entity(reused_second);
+		entity reused_again = test_world.create_entity();
+		CHECK_EQ(reused_again.id, second.id);
+		CHECK_EQ(reused_again.version, second.version + 2);
+	}
+	
+	TEST_CASE("world create entities in bulk")
+	{
+		world test_world{};
+		entity single = test_world.create_entity();
+		test_world.add_components(single, t1{1}, t2{2});
+		test_world.destroy_entity(single);
+		
+		std::vector<entity> created{};
+		{
+			std::span<const entity> bulk_created = test_world.create_entities(5000, t2{-3}, t1{3});
+			created.assign(bulk_created.begin(), bulk_created.end());
+		}
+		REQUIRE_EQ(created.size(), 5000);
+		// the id of the destroyed entity gets reused
+		CHECK_EQ(created.front().id, single.id);
+		CHECK_NE(created.front().version, single.version);
+		
+		for (entity current: created)
+		{
+			REQUIRE(test_world.is_alive(current));
+			CHECK_EQ(test_world.get_component<t1>(current).data, 3);
+			CHECK_EQ(test_world.get_component<t2>(current).data, -3);
+		}
+		CHECK_EQ(test_world.get_archetype_of(created.back()).size(), created.size());
+		
+		std::size_t n_iterated = 0;
+		test_world.for_all(with<const t1 &, const t2 &>, [&](entity, const t1 &, const t2 &)
+		{
+			++n_iterated;
+		});
+		CHECK_EQ(n_iterated, created.size());
+		
+		std::span<const entity> defaulted = test_world.create_entities<t3>(3);
+		REQUIRE_EQ(defaulted.size(), 3);
+		CHECK_EQ(test_world.get_component<t3>(defaulted[2]).data, t3().data);
+		CHECK_FALSE(test_world.has_component<t1>(defaulted[2]));
+		
+		std::span<const entity> empty = test_world.create_entities(2);
+		REQUIRE_EQ(empty.size(), 2);
+		CHECK(test_world.get_archetype_of(empty[0]).get_contained_types().empty());
+		
+		CHECK(test_world.create_entities(0, t1{}, t4{}).empty());
+		CHECK(test_world.create_entities<t1, t2>(0).empty());
+		CHECK(test_world.create_entities(0).empty());
+	}
+	
+	TEST_CASE("world create entities destructor calls")
+	{
+		delete_detector::delete_count = 0;
+		delete_detector::construct_count = 0;
+		{
+			world test_world{};
+			test_world.create_entities(100, delete_detector{});
+			CHECK_EQ(delete_detector::construct_count, 101);
+			CHECK_EQ(delete_detector::delete_count, 1);
+		}
+		CHECK_EQ(delete_detector::delete_count, delete_detector::construct_count);
+	}
+	
+	TEST_CASE("world instantiate")
+	{
+		delete_detector::delete_count = 0;
+		delete_detector::construct_count = 0;
+		{
+			world test_world{};
+			entity prototype = test_world.create_entity();
+			test_world.add_components(prototype, t1{5}, t2{7}, delete_detector{});
+			const std::uint64_t constructed_before = delete_detector::construct_count;
+			
+			const std::size_t n_copies = 2 * test_world.get_archetype_of(prototype).internal().chunk_capacity() + 3;
+			std::span<const entity> copies = test_world.instantiate(prototype, n_copies);
+			REQUIRE_EQ(copies.size(), n_copies);
+			CHECK_EQ(delete_detector::construct_count, constructed_before + n_copies);
+			
+			for (entity copy: copies)
+			{
+				CHECK_EQ(&test_world.get_archetype_of(copy), &test_world.get_archetype_of(prototype));
+				CHECK_EQ(test_world.get_component<t1>(copy).data, 5);
+				CHECK_EQ(test_world.get_component<t2>(copy).data, 7);
+			}
+			
+			// copies are independent of their prototype
+			test_world.get_component<t1>(copies[0]).data = 1;
+			CHECK_EQ(test_world.get_component<t1>(prototype).data, 5);
+			
+			entity empty = test_world.create_entity();
+			CHECK(test_world.instantiate(empty, 2).size() == 2);
+			CHECK(test_world.instantiate(prototype, 0).empty());
+		}
+		CHECK_EQ(delete_detector::delete_count, delete_detector::construct_count);
+	}
+	
+	/// copy constructible according to std::is_copy_constructible_v, but its copy constructor does not compile
+	struct move_only_contents
+	{
+		std::vector<std::unique_ptr<int>> values{};
+	};
+}
+
+template<>
+struct arch::is_copyable_component<world_test::move_only_contents> : std::false_type
+{
+};
+
+namespace world_test
+{
+	TEST_CASE("world components with move only contents")
+	{
+		world test_world{};
+		entity created = test_world.create_entity();
+		test_world.add_component(created, move_only_contents{});
+		test_world.get_component<move_only_contents>(created).values.push_back(std::make_unique<int>(3));
+		test_world.add_component(created, t1{});
+		test_world.remove_components<t1>(created);
+		
+		std::size_t n_values = 0;
+		test_world.for_all(with<move_only_contents &>, [&](entity, move_only_contents &component)
+		{
+			n_values += component.values.size();
+		});
+		CHECK_EQ(n_values, 1);
+		CHECK_EQ(*test_world.get_component<move_only_contents>(created).values.front(), 3);
+		
+		// their chunks can not be shared or copied, which fails before the world gets changed
+		test_world.set_rollback_capacity(1);
+		CHECK_THROWS_AS(std::ignore = test_world.fork(), std::invalid_argument);
+		CHECK_THROWS_AS(test_world.capture_state(), std::invalid_argument);
+		CHECK_EQ(test_world.captured_state_count(), 0);
+		CHECK_THROWS_AS(test_world.instantiate(created, 3), std::invalid_argument);
+		CHECK_EQ(test_world.get_archetype_of(created).size(), 1);
+		
+		test_world.destroy_entity(created);
+		CHECK_NE(test_world.fork(), nullptr);
+		test_world.capture_state();
+		CHECK_EQ(test_world.captured_state_count(), 1);
+	}
+	
+	TEST_CASE("world observers")
+	{
+		world test_world{};
+		std::vector<entity> added{};
+		std::vector<entity> removed{};
+		std::vector<entity> destroyed{};
+		std::size_t n_added_batches = 0;
+		
+		test_world.on_add<t1>([&](std::span<const entity> entities)
+		{
+			added.insert(added.end(), entities.begin(), entities.end());
+			++n_added_batches;
+		});
+		test_world.on_remove<t1>([&](std::span<const entity> entities)
+		{
+			removed.insert(removed.end(), entities.begin(), entities.end());
+		});
+		test_world.on_destroy([&](std::span<const entity> entities)
+		{
+			destroyed.insert(destroyed.end(), entities.begin(), entities.end());
+		});
+		
+		// events are queued until they get delivered
+		std::span<const entity> created_span = test_world.create_entities(10, t1{}, t2{});
+		const std::vector<entity> created(created_span.begin(), created_span.end());
+		entity single = test_world.create_entity();
+		test_world.add_component(single, t1{});
+		test_world.add_component(single, t3{});
+		CHECK(added.empty());
+		
+		test_world.deliver_observer_events();
+		CHECK_EQ(added.size(), 11);
+		CHECK_EQ(n_added_batches, 1);
+		CHECK_EQ(added.back(), single);
+		
+		// unobserved components do not cause events
+		test_world.remove_components<t2>(created[0]);
+		test_world.remove_components<t1, t3>(single);
+		test_world.destroy_entity(created[1]);
+		test_world.deliver_observer_events();
+		CHECK_EQ(added.size(), 11);
+		CHECK_EQ(removed, std::vector<entity>{single, created[1]});
+		CHECK_EQ(destroyed, std::vector<entity>{created[1]});
+		
+		// events caused by observers are delivered in the same call
+		test_world.on_destroy([&](std::span<const entity> entities)
+		{
+			for (entity current: entities)
+			{
+				test_world.add_component(single, t1{static_cast<int>(current.id)});
+			}
+		});
+		test_world.destroy_entity(created[2]);
+		test_world.deliver_observer_events();
+		CHECK_EQ(added.back(), single);
+		CHECK_EQ(added.size(), 12);
+		CHECK_EQ(destroyed.size(), 2);
+	}
+	
+	TEST_CASE("world observers registering observers")
+	{
+		world test_world{};
+		std::size_t n_registered = 0;
+		std::size_t n_added_t1 = 0;
+		std::size_t n_added_t2 = 0;
+		std::size_t n_destroyed = 0;
+		
+		// enough registrations to reallocate the vectors of the observer that is still running
+		test_world.on_add<t1>([&](std::span<const entity> entities)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				test_world.on_add<t1>([&](std::span<const entity> added)
+				{
+					n_added_t1 += added.size();
+				});
+				test_world.on_add<t2>([&](std::span<const entity> added)
+				{
+					n_added_t2 += added.size();
+				});
+				test_world.on_destroy([&](std::span<const entity> destroyed)
+				{
+					n_destroyed += destroyed.size();
+				});
+			}
+			n_registered += 16;
+			for (entity added: entities)
+			{
+				test_world.add_component(added, t2{});
+			}
+		});
+		test_world.on_destroy([&](std::span<const entity>)
+		{
+			test_world.on_destroy([](std::span<const entity>)
+			{
+			});
+		});
+		
+		// registered observers only see the events queued after the delivery
+		const entity created = test_world.create_entity();
+		test_world.add_component(created, t1{});
+		test_world.deliver_observer_events();
+		CHECK_EQ(n_registered, 16);
+		CHECK_EQ(n_added_t1, 0);
+		CHECK_EQ(n_added_t2, 0);
+		
+		const entity second = test_world.create_entity();
+		test_world.add_component(second, t1{});
+		test_world.destroy_entity(created);
+		test_world.deliver_observer_events();
+		CHECK_EQ(n_registered, 32);
+		CHECK_EQ(n_added_t1, 16);
+		CHECK_EQ(n_added_t2, 16);
+		CHECK_EQ(n_destroyed, 16);
+	}
+	
+	TEST_CASE("world fork")
+	{
+		delete_detector::delete_count = 0;
+		delete_detector::construct_count = 0;
+		std::unique_ptr<world> outliving_fork{};
+		entity kept{};
+		{
+			world test_world{};
+			std::vector<entity> created{};
+			for (int i = 0; i < 3000; ++i)
+			{
+				entity current = test_world.create_entity();
+				test_world.add_components(current, t1{i}, t2{});
+				created.push_back(current);
+			}
+			entity detected = test_world.create_entity();
+			test_world.add_components(detected, t1{}, delete_detector{});
+			
+			std::unique_ptr<world> forked = test_world.fork();
+			const world &const_forked = *forked;
+			const world &const_world = test_world;
+			CHECK(forked->is_alive(created[10]));
+			CHECK_EQ(const_forked.get_component<t1>(created[10]).data, 10);
+			// chunks are shared until they are written to
+			CHECK_EQ(&const_forked.get_component<t1>(created[10]), &const_world.get_component<t1>(created[10]));
+			std::size_t n_read = 0;
+			forked->for_all(with<t1, t2>, [&](entity, const t1 &, const t2 &)
+			{
+				++n_read;
+			});
+			CHECK_EQ(n_read, 3000);
+			CHECK_EQ(&const_forked.get_component<t1>(created[10]), &const_world.get_component<t1>(created[10]));
+			
+			// writes only copy the written chunks
+			test_world.get_component<t1>(created[0]).data = -1;
+			CHECK_EQ(const_forked.get_component<t1>(created[0]).data, 0);
+			CHECK_NE(&const_forked.get_component<t1>(created[0]), &const_world.get_component<t1>(created[0]));
+			CHECK_EQ(&const_forked.get_component<t1>(created[2999]), &const_world.get_component<t1>(created[2999]));
+			
+			test_world.destroy_entity(created[1]);
+			test_world.add_component(created[2], t3{});
+			test_world.create_entities(100, t1{7}, t2{});
+			test_world.for_all(with<t1 &>, [](entity, t1 &component)
+			{
+				component.data += 1;
+			});
+			CHECK(forked->is_alive(created[1]));
+			CHECK_FALSE(forked->has_component<t3>(created[2]));
+			for (int i = 0; i < 3000; ++i)
+			{
+				CHECK_EQ(const_forked.get_component<t1>(created[i]).data, i);
+			}
+			
+			// the fork can be written to as well, without changing the world it was forked from
+			forked->get_component<t1>(created[5]).data = 50;
+			forked->destroy_entity(detected);
+			CHECK_EQ(test_world.get_component<t1>(created[5]).data, 6);
+			CHECK(test_world.is_alive(detected));
+			
+			forked.reset();
+			test_world.destroy_entity(created[3]);
+			outliving_fork = test_world.fork();
+			kept = created[4];
+		}
+		// forks can outlive the world they were forked from
+		CHECK_EQ(std::as_const(*outliving_fork).get_component<t1>(kept).data, 5);
+		outliving_fork.reset();
+		CHECK_EQ(delete_detector::delete_count, delete_detector::construct_count);
+		
+		// a fork can be read on another thread while its source keeps changing
+		world test_world{};
+		test_world.create_entities(5000, t1{1}, t2{});
+		std::unique_ptr<world> forked = test_world.fork();
+		std::size_t sum = 0;
+		std::thread reader([&]()
+		{
+			for (int i = 0; i < 20; ++i)
+			{
+				forked->for_all(with<t1>, [&](entity, const t1 &component)
+				{
+					sum += component.data;
+				});
+			}
+		});
+		for (int i = 0; i < 20; ++i)
+		{
+			test_world.for_all(with<t1 &>, [](entity, t1 &component)
+			{
+				component.data += 1;
+			});
+			test_world.create_entities(100, t1{1}, t2{});
+		}
+		reader.join();
+		CHECK_EQ(sum, 20 * 5000);
+	}
+	
+	TEST_CASE("world rollback")
+	{
+		delete_detector::delete_count = 0;
+		delete_detector::construct_count = 0;
+		{
+			world test_world{};
+			test_world.set_rollback_capacity(3);
+			std::vector<entity> created{};
+			std::span<const entity> initial = test_world.create_entities(3000, t1{0}, t2{});
+			created.assign(initial.begin(), initial.end());
+			test_world.add_components(created[7], t3{}, delete_detector{});
+			
+			// alive state, t1 value and presence of t3 of every entity created so far
+			using recorded_state = std::vector<std::tuple<bool, int, bool>>;
+			auto record = [&]()
+			{
+				recorded_state recorded{};
+				for (entity current: created)
+				{
+					const bool alive = test_world.is_alive(current);
+					recorded.emplace_back(alive, alive ? std::as_const(test_world).get_component<t1>(current).data : 0,
+					                      alive && test_world.has_component<t3>(current));
+				}
+				return recorded;
+			};
+			auto simulate = [&](int step)
+			{
+				test_world.for_all(with<t1 &>, [](entity, t1 &component)
+				{
+					component.data += 1;
+				});
+				test_world.destroy_entity(created[100 + step]);
+				test_world.add_component(created[200 + step], t3{});
+				std::span<const entity> added = test_world.create_entities(700, t1{step}, t2{});
+				created.insert(created.end(), added.begin(), added.end());
+			};
+			
+			test_world.capture_state();
+			const recorded_state first = record();
+			simulate(1);
+			test_world.capture_state();
+			const recorded_state second = record();
+			const std::size_t n_created_at_second = created.size();
+			entity created_after_second = test_world.create_entity();
+			simulate(2);
+			test_world.capture_state();
+			simulate(3);
+			CHECK_EQ(test_world.captured_state_count(), 3);
+			// consumes every change up to now
+			arch::change_tracker rollback_tracker{};
+			test_world.for_all(with<t2> && arch::changed<t1>, rollback_tracker, [](entity, const t2 &) {});
+			
+			test_world.rollback(1);
+			CHECK_EQ(test_world.captured_state_count(), 2);
+			for (std::size_t i = n_created_at_second; i < created.size(); ++i)
+			{
+				CHECK_FALSE(test_world.is_alive(created[i]));
+			}
+			created.resize(n_created_at_second);
+			CHECK(record() == second);
+			// ids of dead entities get reused in the same order as before
+			CHECK_EQ(test_world.create_entity(), created_after_second);
+			
+			// changed filters see every component once after a rollback
+			std::size_t n_changed = 0;
+			test_world.for_all(with<t2> && arch::changed<t1>, rollback_tracker, [&](entity, const t2 &)
+			{
+				++n_changed;
+			});
+			test_world.for_all(with<t2> && arch::changed<t1>, rollback_tracker, [&](entity, const t2 &)
+			{
+				++n_changed;
+			});
+			CHECK_EQ(n_changed, n_created_at_second - 1);
+			
+			// resimulating and rolling back again
+			simulate(4);
+			test_world.capture_state();
+			simulate(5);
+			test_world.rollback(2);
+			CHECK_EQ(test_world.captured_state_count(), 1);
+			created.resize(3000);
+			CHECK(record() == first);
+			CHECK_EQ(std::as_const(test_world).get_component<t1>(created[2999]).data, 0);
+			
+			// the ring keeps the newest states
+			for (int i = 0; i < 5; ++i)
+			{
+				simulate(10 + i);
+				test_world.capture_state();
+			}
+			CHECK_EQ(test_world.captured_state_count(), 3);
+			test_world.rollback(2);
+			CHECK_EQ(std::as_const(test_world).get_component<t1>(created[0]).data, 3);
+		}
+		CHECK_EQ(delete_detector::delete_count, delete_detector::construct_count);
+	}
+	
+	TEST_CASE("world merge")
+	{
+		delete_detector::delete_count = 0;
+		delete_detector::construct_count = 0;
+		{
+			world live_world{};
+			std::span<const entity> live_created = live_world.create_entities(1500, t1{-1}, t2{});
+			std::vector<entity> live_entities(live_created.begin(), live_created.end());
+			live_world.destroy_entity(live_entities[10]);
+			live_world.destroy_entity(live_entities[20]);
+			std::size_t n_observed = 0;
+			live_world.on_add<t3>([&](std::span<const entity> added)
+			{
+				n_observed += added.size();
+			});
+			
+			// the level gets loaded on another thread
+			auto staging_world = std::make_unique<world>();
+			std::thread loader([&]()
+			{
+				staging_world->create_entities(2500, t1{}, t2{});
+				staging_world->create_entities(300, t1{}, t3{}, delete_detector{});
+				staging_world->destroy_entity({5, 0});
+				staging_world->for_all(with<t1 &>, [](entity current, t1 &component)
+				{
+					component.data = static_cast<int>(current.id);
+				});
+			});
+			loader.join();
+			
+			std::vector<entity> remapped = live_world.merge_from(std::move(*staging_world));
+			REQUIRE_EQ(remapped.size(), 2800);
+			CHECK(remapped[5] == entity::null());
+			// ids of dead entities get reused first
+			CHECK(remapped[0] == entity{20, 1});
+			CHECK(remapped[1] == entity{10, 1});
+			for (std::size_t id = 0; id < remapped.size(); ++id)
+			{
+				if (id != 5)
+				{
+					REQUIRE(live_world.is_alive(remapped[id]));
+					CHECK_EQ(live_world.get_component<t1>(remapped[id]).data, static_cast<int>(id));
+					CHECK_EQ(live_world.has_component<t3>(remapped[id]), id >= 2500);
+				}
+			}
+			CHECK_EQ(live_world.get_component<t1>(live_entities[0]).data, -1);
+			CHECK_EQ(n_observed, 0);
+			live_world.deliver_observer_events();
+			CHECK_EQ(n_observed, 300);
+			
+			std::size_t n_with_t2 = 0;
+			live_world.for_all(with<t2>, [&](entity, const t2 &)
+			{
+				++n_with_t2;
+			});
+			CHECK_EQ(n_with_t2, 1498 + 2499);
+			
+			// the staging world is left empty but usable
+			std::size_t n_left = 0;
+			staging_world->for_all(with<t1>, [&](entity, const t1 &)
+			{
+				++n_left;
+			});
+			CHECK_EQ(n_left, 0);
+			CHECK(staging_world->create_entities(10, t1{}).front() == entity{0, 0});
+			staging_world.reset();
+			
+			// merged entities behave like all others
+			for (std::size_t id = 2400; id < 2700; ++id)
+			{
+				live_world.destroy_entity(remapped[id]);
+			}
+			live_world.add_component(remapped[2799], t4{});
+			live_world.remove_components<t3>(remapped[2798]);
+			CHECK_EQ(live_world.get_component<t1>(remapped[2799]).data, 2799);
+			CHECK_EQ(live_world.get_component<t1>(remapped[2798]).data, 2798);
+			CHECK_EQ(live_world.get_component<t1>(remapped[2399]).data, 2399);
+		}
+		CHECK_EQ(delete_detector::delete_count, delete_detector::construct_count);
+	}
+}